@@ -0,0 +1,138 @@
+/*
+ * open.c - File loading benchmark
+ *
+ * Measures how long it takes to load a large file into the editor buffer.
+ * The legacy path reads the file with getline() and inserts every line on its
+ * own through v_insert_row(), which is how v_open() used to work. It is
+ * compared against v_open() itself, which appends whole batches of rows at
+ * once, both with a single thread and with one indexing thread per core. The
+ * number of lines defaults to 10 million and can be given as the first
+ * argument.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include <void.h>
+
+#define V_BENCH_LINES	10000000	/* Default number of lines */
+
+static double v_bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int v_bench_gen(char *path, long lines)
+{
+	FILE *fp = fopen(path, "w");
+	if (!fp)
+		return V_ERR;
+
+	for (long i = 0; i < lines; i++)
+		fprintf(fp, "%ld\tThe quick brown fox jumps%.*s\n", i,
+			(int)(i % 40), "........................................");
+
+	return fclose(fp) == 0 ? V_OK : V_ERR;
+}
+
+static int v_bench_legacy(struct v_state *v, char *path)
+{
+	FILE *fp = fopen(path, "r");
+	if (!fp)
+		return V_ERR;
+
+	char *s = NULL;
+	size_t cap = 0;
+	ssize_t len = 0;
+	while ((len = getline(&s, &cap, fp)) != -1) {
+		while (len > 0 && (s[len - 1] == '\n' || s[len - 1] == '\r'))
+			len--;
+		if (v_insert_row(v, v->nrows, s, len) == V_ERR)
+			break;
+	}
+
+	free(s);
+	fclose(fp);
+
+	return V_OK;
+}
+
+static double v_bench_run(char *path, bool legacy, bool pt, bool seq,
+			  int *nrows)
+{
+	struct v_state *v = v_new_state();
+	if (!v)
+		return -1;
+	v->pt = pt;
+	if (seq)
+		v->threads = 1;
+
+	double start = v_bench_now();
+	int ret = legacy ? v_bench_legacy(v, path) : v_open(v, path);
+	double end = v_bench_now();
+
+	*nrows = v->nrows;
+	v_free_rows(v);
+	free(v->filename);
+	free(v);
+
+	return ret == V_OK ? end - start : -1;
+}
+
+int main(int argc, char *argv[])
+{
+	long lines = argc > 1 ? atol(argv[1]) : V_BENCH_LINES;
+	char path[] = "/tmp/void-bench-XXXXXX";
+
+	int fd = mkstemp(path);
+	if (fd == -1) {
+		perror("mkstemp");
+		return EXIT_FAILURE;
+	}
+	close(fd);
+
+	if (v_bench_gen(path, lines) == V_ERR) {
+		perror("write");
+		unlink(path);
+		return EXIT_FAILURE;
+	}
+
+	struct {
+		char *name;
+		bool legacy;
+		bool pt;
+		bool seq;
+	} runs[] = {
+		{"getline + v_insert_row", true, false, true},
+		{"v_open (1 thread)", false, false, true},
+		{"v_open", false, false, false},
+		{"v_open (piece table)", false, true, false},
+	};
+
+	printf("open: %ld lines\n", lines);
+	for (size_t i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+		int nrows = 0;
+		double t = v_bench_run(path, runs[i].legacy, runs[i].pt,
+				       runs[i].seq, &nrows);
+		printf("  %-24s %8.3f s  %d rows\n", runs[i].name, t, nrows);
+	}
+
+	unlink(path);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+/*
+ * scan.c - Line scanning benchmark
+ *
+ * Measures how fast a block of text is split into lines, in GB/s. Each
+ * flavour of v_scan_lines() is forced in turn through v_scan_use(), the scalar
+ * one being the memchr() loop every file used to be split with. getline() over
+ * the same block is measured as well for reference. A tenth of the lines end
+ * with "\r\n", and every run has to find the very same lines. The size of the
+ * block defaults to 256 MiB and can be given in MiB as the first argument.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include <void.h>
+
+#define V_BENCH_MIB	256	/* Default size of the block in MiB */
+#define V_BENCH_RUNS	5	/* Runs per flavour, the best one is kept */
+#define V_BENCH_MAX	4096	/* Lines per call to v_scan_lines() */
+
+static double v_bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void v_bench_gen(char *p, size_t size)
+{
+	static const char text[] = "The quick brown fox\tjumps over the lazy "
+				   "dog, and then some more words to fill it";
+	size_t i = 0;
+
+	srand(1);
+	while (i < size) {
+		size_t len = rand() % 81;
+		bool crlf = rand() % 10 == 0;
+
+		for (size_t k = 0; k < len && i < size; k++)
+			p[i++] = text[(k + len) % (sizeof(text) - 1)];
+		if (crlf && i < size)
+			p[i++] = '\r';
+		if (i < size)
+			p[i++] = '\n';
+	}
+}
+
+static double v_bench_getline(char *p, size_t size, long *nlines, size_t *sum)
+{
+	FILE *fp = fmemopen(p, size, "r");
+	if (!fp)
+		return -1;
+
+	char *s = NULL;
+	size_t cap = 0;
+	ssize_t len = 0;
+
+	double start = v_bench_now();
+	while ((len = getline(&s, &cap, fp)) != -1) {
+		if (len > 0 && s[len - 1] == '\n')
+			len--;
+		while (len > 0 && s[len - 1] == '\r')
+			len--;
+		(*nlines)++;
+		*sum += len;
+	}
+	double end = v_bench_now();
+
+	free(s);
+	fclose(fp);
+
+	return end - start;
+}
+
+static double v_bench_scan(char *p, size_t size, long *nlines, size_t *sum)
+{
+	static struct v_line lines[V_BENCH_MAX];
+	char *end = p + size;
+	int n = 0;
+
+	double start = v_bench_now();
+	while (p < end) {
+		p = v_scan_lines(p, end, true, lines, V_BENCH_MAX, &n);
+		for (int i = 0; i < n; i++)
+			*sum += lines[i].len;
+		*nlines += n;
+	}
+
+	return v_bench_now() - start;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t size = (size_t)(argc > 1 ? atol(argv[1]) : V_BENCH_MIB) << 20;
+	char *p = malloc(size);
+	if (!p) {
+		perror("malloc");
+		return EXIT_FAILURE;
+	}
+	v_bench_gen(p, size);
+
+	const char *flavours[] = {"getline", "scalar", "sse2", "avx2"};
+	long ref_lines = -1;
+	size_t ref_sum = 0;
+	int ret = EXIT_SUCCESS;
+
+	printf("scan: %zu MiB\n", size >> 20);
+	for (size_t i = 0; i < sizeof(flavours) / sizeof(flavours[0]); i++) {
+		bool scan = strcmp(flavours[i], "getline") != 0;
+		if (scan && v_scan_use(flavours[i]) == V_ERR) {
+			printf("  %-8s unsupported\n", flavours[i]);
+			continue;
+		}
+
+		double best = -1;
+		long nlines = 0;
+		size_t sum = 0;
+		for (int run = 0; run < V_BENCH_RUNS; run++) {
+			nlines = 0;
+			sum = 0;
+			double t = scan ? v_bench_scan(p, size, &nlines, &sum) :
+					  v_bench_getline(p, size, &nlines, &sum);
+			if (t > 0 && (best < 0 || t < best))
+				best = t;
+		}
+
+		if (ref_lines == -1) {
+			ref_lines = nlines;
+			ref_sum = sum;
+		}
+
+		bool same = nlines == ref_lines && sum == ref_sum;
+		printf("  %-8s %8.2f GB/s  %ld lines%s\n", flavours[i],
+		       size / best / 1e9, nlines, same ? "" : "  MISMATCH");
+		if (!same)
+			ret = EXIT_FAILURE;
+	}
+
+	free(p);
+
+	return ret;
+}
@@ -0,0 +1,175 @@
+/*
+ * screen.c - Screen refresh benchmark
+ *
+ * Measures how many bytes each screen refresh sends to the terminal and how
+ * long it takes, drawing through curses and drawing on the raw escape
+ * sequence screen. Both draw on a pretend xterm whose output goes into a
+ * temporary file, and go through the very same frames: holding j down,
+ * paging down, typing into a line, moving the cursor alone and redrawing the
+ * whole screen. The number of frames per run defaults to 2000 and can be
+ * given as the first argument.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <ncurses.h>
+#include <sys/stat.h>
+
+#include <void.h>
+
+#define V_BENCH_FRAMES	2000		/* Default number of frames */
+#define V_BENCH_LINES	100000		/* Lines of the edited buffer */
+#define V_BENCH_DOTS	"........................................"
+#define V_BENCH_TERM	"xterm-256color"	/* Pretend terminal type */
+
+static double v_bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long v_bench_size(FILE *fp)
+{
+	struct stat st;
+
+	return fstat(fileno(fp), &st) == 0 ? st.st_size : 0;
+}
+
+static int v_bench_fill(struct v_state *v)
+{
+	static char text[V_BENCH_LINES * 64];
+	static struct v_line lines[V_BENCH_LINES];
+	char *p = text;
+
+	for (int i = 0; i < V_BENCH_LINES; i++) {
+		int len = sprintf(p, "%d\tThe quick brown fox jumps%.*s", i,
+				  i % 40, V_BENCH_DOTS);
+		lines[i].s = p;
+		lines[i].len = len;
+		p += len;
+	}
+
+	return v_append_rows(v, lines, V_BENCH_LINES);
+}
+
+static void v_bench_step(struct v_state *v, int kind, int i)
+{
+	switch (kind) {
+	case 0:
+		v_cur_down(v);
+		break;
+	case 1:
+		v_npage(v);
+		break;
+	case 2:
+		v_insert(v, 'a' + i % 26);
+		break;
+	case 3:
+		if (i % 2)
+			v_cur_left(v);
+		else
+			v_cur_right(v);
+		break;
+	case 4:
+		v_redraw(v);
+		break;
+	}
+}
+
+static void v_bench_run(struct v_state *v, FILE *out, int kind, int frames,
+			long *bytes, double *us)
+{
+	v->cur_y = kind == 2 ? 50 : 0;
+	v->cur_x = 0;
+	v->rowoff = 0;
+	v->coloff = 0;
+	v_redraw(v);
+
+	long from = v_bench_size(out);
+	double t = 0;
+	for (int i = 0; i < frames; i++) {
+		v_bench_step(v, kind, i);
+
+		double start = v_bench_now();
+		v_rfsh_scr(v);
+		t += v_bench_now() - start;
+	}
+
+	*bytes = v_bench_size(out) - from;
+	*us = t * 1e6 / frames;
+}
+
+int main(int argc, char *argv[])
+{
+	int frames = argc > 1 ? atoi(argv[1]) : V_BENCH_FRAMES;
+	if (frames < 1)
+		frames = V_BENCH_FRAMES;
+
+	FILE *out = tmpfile();
+	FILE *in = fopen("/dev/null", "r");
+	if (!out || !in) {
+		perror("tmpfile");
+		return EXIT_FAILURE;
+	}
+
+	setenv("LINES", "50", 1);
+	setenv("COLUMNS", "160", 1);
+	SCREEN *term = newterm(V_BENCH_TERM, out, in);
+	if (!term) {
+		fprintf(stderr, "screen: no %s terminal\n", V_BENCH_TERM);
+		return EXIT_SUCCESS;
+	}
+
+	/* There is never a key waiting, but /dev/null always reads */
+	typeahead(-1);
+
+	struct v_state *v = v_new_state();
+	if (!v || v_bench_fill(v) == V_ERR) {
+		perror("fill");
+		return EXIT_FAILURE;
+	}
+	v_init_colors(v);
+
+	const char *kinds[] = {
+		"scroll", "page down", "typing", "cursor only", "full redraw",
+	};
+
+	printf("screen: %dx%d, %d frames per run\n", COLS, LINES, frames);
+	for (int k = 0; k < 5; k++) {
+		long bytes[2];
+		double us[2];
+
+		v_bench_run(v, out, k, frames, &bytes[0], &us[0]);
+
+		v->scr = v_scr_new(fileno(out));
+		if (!v->scr) {
+			perror("v_scr_new");
+			return EXIT_FAILURE;
+		}
+		v_bench_run(v, out, k, frames, &bytes[1], &us[1]);
+		v_scr_free(v->scr);
+		v->scr = NULL;
+
+		printf("  %-12s curses %9ld B %8.1f us/frame   "
+		       "raw %9ld B %8.1f us/frame\n", kinds[k], bytes[0],
+		       us[0], bytes[1], us[1]);
+	}
+
+	endwin();
+	delscreen(term);
+	fclose(in);
+	fclose(out);
+
+	return EXIT_SUCCESS;
+}
@@ -13,7 +13,12 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
 
 #define V_VER		"0.0.1"
 #define V_DESC		"Built like Vim and GNU nano, but worse."
@@ -31,7 +36,52 @@
 #define V_BAR_BG	COLOR_WHITE	/* Editor bar background color */
 
 #define V_TABSTP	8		/* Default tabstop size */
+#define V_ROW_FRESH	-1		/* Row rendering is up to date */
+#define V_ADD_BLK	65536		/* First arena block size */
+#define V_ARENA_MAX	16777216	/* Largest arena block size */
+#define V_LEAF_MAX	128		/* Rows per row tree leaf */
+#define V_NODE_MAX	64		/* Children per row tree internal node */
+#define V_TREE_DEPTH	16		/* Maximum height of the row tree */
+#define V_READ_BLK	1048576		/* File reading block size */
+#define V_LOAD_BATCH	4096		/* Lines per background loading batch */
+#define V_LOAD_POLL	50		/* Background loading poll delay (ms) */
+#define V_LOAD_SLICE	16		/* Batches appended per loading poll */
 #define V_FILE_MODE	0644		/* Default text files permission */
+#define V_SAVE_IOV	1024		/* Pieces of text per writev() call */
+#define V_JRNL_EXT	".vswp"		/* Edit journal swap file extension */
+#define V_JRNL_MAGIC	"VOIDJRN3"	/* Edit journal swap file signature */
+#define V_JRNL_BUF	65536		/* Edit journal buffer size */
+#define V_JRNL_REC	17		/* Edit journal record header size */
+#define V_JRNL_SYNC	500		/* Edit journal fsync() delay (ms) */
+#define V_INDEX_BLK	4194304		/* Bytes indexed per thread per round */
+#define V_THREADS_MAX	64		/* Maximum number of indexing threads */
+#define V_PAGE_BUDGET	64		/* Read-only view memory budget (MiB) */
+#define V_PAGE_EVERY	256		/* First lines per view checkpoint */
+#define V_PAGE_WIN	1024		/* Rows per read-only view window */
+#define V_PAGE_SCAN	4096		/* Lines per read-only indexing scan */
+#define V_FOLLOW_POLL	250		/* Followed file polling delay (ms) */
+#define V_FOLLOW_SLICE	16		/* Blocks read per follow mode poll */
+#define V_KEY_BATCH	256		/* Queued keys applied per refresh */
+#define V_KEY_LATENCY	30		/* Longest refresh delay for keys (ms) */
+#define V_PASTE_ON	"\033[?2004h"	/* Turns bracketed paste on */
+#define V_PASTE_OFF	"\033[?2004l"	/* Turns bracketed paste off */
+#define V_PASTE_BEGIN	"\033[200~"	/* Starts a bracketed paste */
+#define V_PASTE_END	"\033[201~"	/* Ends a bracketed paste */
+#define V_PASTE_WAIT	1000		/* Longest pause inside a paste (ms) */
+#define V_PASTE_BATCH	256		/* Pasted lines split per scan */
+#define V_SCR_OUT	16384		/* Initial raw screen frame size */
+#define V_SCR_SEQ	32		/* Longest raw screen escape sequence */
+#define V_SCR_GAP	4		/* Unchanged cells rewritten in a run */
+#define V_SCR_ECH	8		/* Blank cells erased, not written */
+#define V_ESC_SYNC_ON	"\033[?2026h"	/* Starts a synchronized update */
+#define V_ESC_SYNC_OFF	"\033[?2026l"	/* Ends a synchronized update */
+#define V_ESC_CLEAR	"\033[m\033[H\033[2J"	/* Clears the whole terminal */
+#define V_ESC_EL	"\033[K"	/* Erases up to the end of the line */
+#define V_CACHE_DIR	"void"		/* Line index cache directory name */
+#define V_CACHE_EXT	".idx"		/* Line index cache file extension */
+#define V_CACHE_MAGIC	"VOIDIDX2"	/* Line index cache file signature */
+#define V_CACHE_PROBE	4096		/* Bytes summed to recognise a file */
+#define V_CACHE_SAMPLES	14		/* Probes spread between head and tail */
 
 #define V_OK		0		/* Return value success */
 #define V_ERR		-1		/* Return value failure */
@@ -42,24 +92,494 @@
 #define V_KEY_NL	10		/* Represents a '\n' key */
 #define V_KEY_RET	13		/* Represents a '\r' key */
 #define V_KEY_BKSP	127		/* Represents a BACKSPACE key */
+#define V_KEY_PASTE	01000		/* Represents a bracketed paste start */
+#define V_KEY_PASTE_END	01001		/* Represents a bracketed paste end */
+#define V_SCR_NORMAL	0		/* Raw screen cell drawn as it is */
+#define V_SCR_BAR	1		/* Raw screen cell drawn as a bar */
+#define V_SYNC_NONE	0		/* Never fsync() a saved file */
+#define V_SYNC_FILE	1		/* fsync() a saved file before renaming */
+#define V_SYNC_FULL	2		/* fsync() its directory afterward too */
+#define V_JRNL_INSERT	1		/* Journaled v_insert() */
+#define V_JRNL_NL	2		/* Journaled v_insert_nl() */
+#define V_JRNL_BKSP	3		/* Journaled v_bksp() */
+#define V_JRNL_PASTE	4		/* Journaled v_paste() */
+#define V_JRNL_OPEN	5		/* Journaled v_open_line() */
+
+/**
+ * struct v_piece - represent a piece of text inside a piece table row
+ * s: Start of the text, inside either the original or the add buffer.
+ * len: Length of the text.
+ */
+struct v_piece {
+	char *s;
+	int len;
+};
+
+/**
+ * struct v_line - represent a line of text waiting to become a v_row
+ * s: Start of the text, without its line terminator.
+ * len: Length of the text.
+ */
+struct v_line {
+	char *s;
+	size_t len;
+};
+
+/**
+ * struct v_tab - represent a tab inside the tab index of a v_row
+ * cx: Index of the tab inside the original string.
+ * rx: Column inside the rendered string right after the tab expansion.
+ */
+struct v_tab {
+	int cx;
+	int rx;
+};
 
 /**
  * struct v_row - represent a line of text to be displayed
- * orig: The original string (unrendered).
+ * orig: The original string (unrendered), stored as a gap buffer.
  * ren: The rendered string.
+ * pcs: Array of pieces making up the string in piece table mode.
+ * tabs: Index of the tabs found inside orig, in order.
  * len: The original string length (unrendered).
  * rlen: The rendered string length.
+ * cap: Allocated size of orig, the gap length is cap - len.
+ * gap: Index inside orig where the gap begins.
+ * npcs: Number of pieces inside pcs.
+ * rcap: Allocated size of ren, 0 when ren points at the text of orig.
+ * ntabs: Number of tabs inside tabs.
+ * tcap: Allocated number of tabs inside tabs.
+ * stale: Index of the first character of orig whose rendering inside ren is
+ *	  out of date, or V_ROW_FRESH when ren is up to date.
+ *
+ * The text of orig lives in orig[0..gap) followed by orig[gap + cap - len..cap)
+ * and is not NUL-terminated. A cap of 0 means orig is borrowed read-only
+ * storage holding len contiguous bytes, which the row does not own. When pcs
+ * is set, the text is made of its pieces instead and orig is unused. Use
+ * v_row_seg() to read it. The tab index only covers the tabs found before
+ * stale, the rest of it is rebuilt along with ren.
  */
 struct v_row {
 	char *orig;
 	char *ren;
+	struct v_piece *pcs;
+	struct v_tab *tabs;
 	int len;
 	int rlen;
+	int cap;
+	int gap;
+	int npcs;
+	int rcap;
+	int ntabs;
+	int tcap;
+	int stale;
+};
+
+/**
+ * struct v_leaf - represent a block of consecutive rows inside the row tree
+ * rows: The rows, in order.
+ * n: Number of rows in use.
+ * prev: The leaf holding the rows right before these ones.
+ * next: The leaf holding the rows right after these ones.
+ */
+struct v_leaf {
+	struct v_row rows[V_LEAF_MAX];
+	int n;
+	struct v_leaf *prev;
+	struct v_leaf *next;
+};
+
+/**
+ * struct v_node - represent an internal node of the row tree
+ * kid: The children, either v_node or v_leaf structs depending on the level.
+ * cnt: Number of rows found under each child.
+ * n: Number of children in use.
+ */
+struct v_node {
+	void *kid[V_NODE_MAX];
+	int cnt[V_NODE_MAX];
+	int n;
+};
+
+/**
+ * struct v_blk - represent a block of an append-only text arena
+ * next: The previously filled block.
+ * len: Number of bytes used inside data.
+ * cap: Size of data.
+ * data: The stored bytes.
+ */
+struct v_blk {
+	struct v_blk *next;
+	size_t len;
+	size_t cap;
+	char data[];
+};
+
+/**
+ * struct v_batch - represent a batch of lines loaded in the background
+ * next: The batch loaded right after this one.
+ * off: Offset inside the file right after the last line of the batch.
+ * n: Number of lines inside lines.
+ * lines: The lines, in order.
+ */
+struct v_batch {
+	struct v_batch *next;
+	size_t off;
+	int n;
+	struct v_line lines[V_LOAD_BATCH];
+};
+
+/**
+ * struct v_chunk - represent a chunk of text indexed by a thread of its own
+ * tid: The thread indexing the chunk.
+ * p: Start of the chunk, right after a '\n' unless it starts the block.
+ * end: End of the chunk, right after a '\n' unless it ends the block.
+ * last: Whether a line running past end should be indexed anyway.
+ * started: Whether tid was started, the chunk is indexed in place otherwise.
+ * err: The memory ran out while indexing the chunk.
+ * next: First byte of the chunk which was not consumed.
+ * lines: The lines found inside the chunk, in order.
+ * n: Number of lines inside lines.
+ * cap: Allocated number of lines inside lines.
+ */
+struct v_chunk {
+	pthread_t tid;
+	char *p;
+	char *end;
+	bool last;
+	bool started;
+	bool err;
+	char *next;
+	struct v_line *lines;
+	size_t n;
+	size_t cap;
+};
+
+/**
+ * struct v_loader - represent a file being loaded in the background
+ * tid: The loader thread.
+ * fd: The file being read.
+ * map: Mapping of the file in memory mapped file mode, NULL otherwise.
+ * src: Buffer the whole file is read into in piece table mode, NULL otherwise.
+ * size: Size of the file when the loading started.
+ * arena: Text read by the loader thread, owned by it until it is joined.
+ * added: Offset inside the file right after the last line appended so far.
+ * backlog: More batches were left waiting by the last v_load_poll() call.
+ * threads: Number of threads indexing the lines of the file.
+ * fill: Batch being filled by the loader thread, not queued yet.
+ * from: Start of the block being indexed by the loader thread.
+ * from_off: Offset inside the file of from.
+ * lock: Guards every field below.
+ * cond: Signaled whenever a batch is queued or the loading ends.
+ * head: Oldest batch waiting to be appended to the row tree.
+ * tail: Newest batch waiting to be appended to the row tree.
+ * err: errno value which ended the loading early, 0 if none.
+ * stop: The loader thread is asked to stop early.
+ * end: The loader thread is done.
+ */
+struct v_loader {
+	pthread_t tid;
+	int fd;
+	char *map;
+	char *src;
+	size_t size;
+	struct v_blk *arena;
+	size_t added;
+	bool backlog;
+	int threads;
+	struct v_batch *fill;
+	char *from;
+	size_t from_off;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct v_batch *head;
+	struct v_batch *tail;
+	int err;
+	bool stop;
+	bool end;
+};
+
+/**
+ * struct v_snap - represent a frozen copy of the buffer content to be saved
+ * iov: The pieces of text making up the content, in order.
+ * n: Number of pieces inside iov.
+ * cap: Allocated number of pieces inside iov.
+ * text: Arena holding the text copied out of the rows being edited.
+ * len: Length of the content.
+ * nrows: Number of rows making up the content.
+ * lo: Start of the block of storage the last merged pieces were found in.
+ * hi: End of that block of storage.
+ */
+struct v_snap {
+	struct iovec *iov;
+	size_t n;
+	size_t cap;
+	struct v_blk *text;
+	off_t len;
+	int nrows;
+	char *lo;
+	char *hi;
+};
+
+/**
+ * struct v_saver - represent a file being saved in the background
+ * tid: The saver thread.
+ * started: Whether tid was started, the snapshot was written in place
+ *	    otherwise.
+ * snap: The snapshot being written.
+ * path: The name of the file being written.
+ * sync: fsync() policy, one of the V_SYNC_* values.
+ * mapped: Whether rows still refer to a mapping of the file.
+ * lock: Guards every field below.
+ * cond: Signaled once the saving ends.
+ * err: errno value which made the saving fail, 0 if none.
+ * end: The saver thread is done.
+ */
+struct v_saver {
+	pthread_t tid;
+	bool started;
+	struct v_snap snap;
+	char *path;
+	int sync;
+	bool mapped;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int err;
+	bool end;
+};
+
+/**
+ * struct v_jrnl_hdr - represent the header of an edit journal swap file
+ * magic: V_JRNL_MAGIC, not NUL-terminated.
+ * ino: Inode number of the file the records apply to.
+ * size: Size of the file the records apply to.
+ * sec: Modification time of the file the records apply to, in seconds.
+ * nsec: Nanoseconds part of the modification time.
+ *
+ * Every field but magic is 0 when the records apply to a file which doesn't
+ * exist yet. The whole header is 0 while the records don't apply to a saved
+ * version of the file yet.
+ */
+struct v_jrnl_hdr {
+	char magic[8];
+	uint64_t ino;
+	uint64_t size;
+	int64_t sec;
+	int64_t nsec;
+};
+
+/**
+ * struct v_jrnl - represent the edit journal of the opened file
+ * fd: The swap file, -1 until the first record is written out.
+ * path: The name of the swap file.
+ * hdr: Header of the swap file.
+ * off: Length of the swap file.
+ * mark: Length of the swap file when the last save was started.
+ * synced: When the swap file was last fsync()ed.
+ * unsynced: Some records were written out but not fsync()ed yet.
+ * len: Number of bytes used inside buf.
+ * buf: The records waiting to be written out.
+ */
+struct v_jrnl {
+	int fd;
+	char *path;
+	struct v_jrnl_hdr hdr;
+	off_t off;
+	off_t mark;
+	struct timespec synced;
+	bool unsynced;
+	size_t len;
+	char buf[V_JRNL_BUF];
+};
+
+/**
+ * struct v_cache_hdr - represent the header of a line index cache file
+ * magic: V_CACHE_MAGIC, not NUL-terminated.
+ * ino: Inode number of the indexed file.
+ * size: Size of the indexed file when the index was stored.
+ * sec: Modification time of the indexed file, in seconds.
+ * nsec: Nanoseconds part of the modification time.
+ * scan: Offset inside the file the index goes up to.
+ * line: Offset inside the file of the line being indexed at scan.
+ * head: FNV-1a sum of the first V_CACHE_PROBE bytes before scan.
+ * tail: FNV-1a sum of the last V_CACHE_PROBE bytes before scan.
+ * mid: Sums of V_CACHE_SAMPLES probes spread evenly before scan, combined.
+ * every: Number of lines between two checkpoints.
+ * nckpt: Number of checkpoints following the path.
+ * nlines: Number of lines found before line.
+ * plen: Length of the full path of the indexed file, which follows.
+ */
+struct v_cache_hdr {
+	char magic[8];
+	uint64_t ino;
+	uint64_t size;
+	int64_t sec;
+	int64_t nsec;
+	uint64_t scan;
+	uint64_t line;
+	uint64_t head;
+	uint64_t tail;
+	uint64_t mid;
+	int32_t every;
+	int32_t nckpt;
+	int32_t nlines;
+	uint32_t plen;
+};
+
+/**
+ * struct v_pager - represent a file opened in the read-only view
+ * fd: The file being viewed.
+ * size: Size of the file when it was opened.
+ * ckpt: Offset inside the file of every line whose number is a multiple of
+ *	 every, in order.
+ * nckpt: Number of offsets inside ckpt.
+ * ckmax: Allocated number of offsets inside ckpt, within the memory budget.
+ * every: Number of lines between two checkpoints, doubled whenever ckpt
+ *	  runs out of room.
+ * nlines: Number of lines indexed so far.
+ * scan: Offset inside the file where the indexing goes on from.
+ * line: Offset inside the file of the line being indexed.
+ * done: The whole file was indexed.
+ * cached: Offset scan had when the index was last loaded or stored.
+ * err: errno value which ended the indexing early, 0 if none.
+ * buf: Buffer the file is read into while indexing and seeking.
+ * bcap: Size of buf.
+ * text: Text of the rows inside the window.
+ * tcap: Size of text.
+ * base: Line number of the first row inside the window.
+ * n: Number of rows inside the window.
+ * rows: The window, rows borrowing their text from text.
+ * found: Lines found by each scan of buf while indexing.
+ * wlines: Lines found inside text while filling the window.
+ */
+struct v_pager {
+	int fd;
+	off_t size;
+	off_t *ckpt;
+	int nckpt;
+	int ckmax;
+	int every;
+	int nlines;
+	off_t scan;
+	off_t line;
+	bool done;
+	off_t cached;
+	int err;
+	char *buf;
+	size_t bcap;
+	char *text;
+	size_t tcap;
+	int base;
+	int n;
+	struct v_row rows[V_PAGE_WIN];
+	struct v_line found[V_PAGE_SCAN];
+	struct v_line wlines[V_PAGE_WIN];
+};
+
+/**
+ * struct v_follow - represent a growing file or pipe being followed
+ * fd: The file or pipe being followed.
+ * ino: inotify instance watching the file, -1 when it is polled instead.
+ * pipe: Whether fd is not a regular file, and so can't be read twice.
+ * eof: The pipe was closed, or reading fd failed, nothing more will come.
+ * open: The last row is a line still being written, and was not edited since.
+ * idle: The last wait ended without a key being pressed.
+ * backlog: More text may be waiting after the last v_follow_poll() call.
+ * off: Number of bytes read from fd so far.
+ * len: Number of bytes left inside buf, a '\r' whose line is not done yet.
+ * buf: Buffer fd is read into, V_READ_BLK bytes long.
+ */
+struct v_follow {
+	int fd;
+	int ino;
+	bool pipe;
+	bool eof;
+	bool open;
+	bool idle;
+	bool backlog;
+	off_t off;
+	size_t len;
+	char *buf;
+};
+
+/**
+ * struct v_cell - represent a character cell of the raw screen
+ * ch: The char shown inside the cell.
+ * attr: Attributes of the cell, one of the V_SCR_* values.
+ */
+struct v_cell {
+	char ch;
+	unsigned char attr;
+};
+
+/**
+ * struct v_screen - represent the raw escape sequence screen (see src/screen.c)
+ * fd: File descriptor of the terminal drawn on.
+ * rows: Number of lines of the terminal.
+ * cols: Number of columns of the terminal.
+ * front: Cells as the terminal shows them.
+ * back: Cells as the next frame shows them.
+ * y: Line the next cells are drawn on.
+ * x: Column the next cells are drawn at.
+ * attr: Attributes the next cells are drawn with.
+ * cy: Line the terminal cursor is at, -1 if unknown.
+ * cx: Column the terminal cursor is at, -1 if unknown.
+ * cattr: Attributes the terminal currently draws with.
+ * open: Whether the frame being built started a synchronized update.
+ * out: Escape sequences of the frame being built.
+ * len: Length of out.
+ * cap: Allocated size of out.
+ * bytes: Number of bytes sent to the terminal so far.
+ */
+struct v_screen {
+	int fd;
+	int rows;
+	int cols;
+	struct v_cell *front;
+	struct v_cell *back;
+	int y;
+	int x;
+	int attr;
+	int cy;
+	int cx;
+	int cattr;
+	bool open;
+	char *out;
+	size_t len;
+	size_t cap;
+	size_t bytes;
+};
+
+/**
+ * struct v_damage - represent what the screen shows since the last refresh
+ * lines: Whether each screen line has to be drawn again.
+ * n: Number of screen lines inside lines.
+ * cols: Width of the screen when it was last refreshed.
+ * rowoff: Row offset the screen lines were last drawn with.
+ * coloff: Column offset the screen lines were last drawn with.
+ * all: Every screen line and both bars have to be drawn again.
+ * left: Left part of the status bar as it was last drawn.
+ * right: Right part of the status bar as it was last drawn.
+ * msg: Status message as it was last drawn.
+ */
+struct v_damage {
+	bool *lines;
+	int n;
+	int cols;
+	int rowoff;
+	int coloff;
+	bool all;
+	char left[V_STATS_LEFT_MAX];
+	char right[V_STATS_RIGHT_MAX];
+	char msg[V_STATS_MSG_BUF];
 };
 
 /**
  * struct v_state - current thread information
- * rows: Array of v_row structs.
+ * root: Root of the row tree holding every v_row struct (see src/tree.c).
+ * height: Number of v_node levels in the row tree.
+ * rc_leaf: Row tree leaf of the last looked up row.
+ * rc_base: Line number of the first row inside rc_leaf.
  * nrows: Number of available v_row structs.
  * scr_x: Maximum value of screen x-axis.
  * scr_y: Maximum value of screen y-axis.
@@ -74,9 +594,33 @@ struct v_row {
  * dirty: Available unsaved changes.
  * mode: Current editor mode.
  * run: Current editor running status.
+ * pt: Piece table buffer mode flag.
+ * mm: Memory mapped file mode flag.
+ * src: Read-only original file content, read in piece table mode or mapped
+ *	in memory mapped file mode.
+ * src_len: Length of src.
+ * add: Newest block of the piece table append-only add buffer.
+ * arena: Newest block of the arena holding the text of the loaded rows.
+ * ld: The file being loaded in the background, NULL if none.
+ * sv: The file being saved in the background, NULL if none.
+ * jr: The edit journal of the opened file, NULL if none.
+ * threads: Number of threads indexing the lines of a file being loaded.
+ * sync: fsync() policy when saving, one of the V_SYNC_* values.
+ * view: Read-only view mode flag.
+ * budget: Memory budget of the read-only view, in bytes.
+ * pg: The file opened in the read-only view, NULL if none.
+ * follow: Follow mode flag.
+ * fw: The file or pipe being followed, NULL if none.
+ * dmg: Damage tracking of the screen, see v_rfsh_scr().
+ * batch: Maximum number of queued keys applied before refreshing the screen.
+ * vt: Raw escape sequence screen flag.
+ * scr: The raw escape sequence screen drawn on, NULL when drawing with curses.
  */
 struct v_state {
-	struct v_row *rows;
+	struct v_node *root;
+	int height;
+	struct v_leaf *rc_leaf;
+	int rc_base;
 	int nrows;
 	int scr_x;
 	int scr_y;
@@ -91,6 +635,26 @@ struct v_state {
 	bool dirty;
 	int mode;
 	bool run;
+	bool pt;
+	bool mm;
+	char *src;
+	size_t src_len;
+	struct v_blk *add;
+	struct v_blk *arena;
+	struct v_loader *ld;
+	struct v_saver *sv;
+	struct v_jrnl *jr;
+	int threads;
+	int sync;
+	bool view;
+	size_t budget;
+	struct v_pager *pg;
+	bool follow;
+	struct v_follow *fw;
+	struct v_damage dmg;
+	int batch;
+	bool vt;
+	struct v_screen *scr;
 };
 
 /**
@@ -122,7 +686,7 @@ int v_bottom_pg(struct v_state *v);
 int v_top_pg(struct v_state *v);
 
 /* src/input.c */
-int v_prcs_key(struct v_state *v);
+int v_prcs_keys(struct v_state *v);
 char *v_prompt(struct v_state *v, char *s);
 
 /* src/term.c */
@@ -132,25 +696,123 @@ int v_reset_term(struct v_state *v);
 
 /* src/output.c */
 int v_set_stats_msg(struct v_state *v, const char *fmt, ...);
+int v_scroll(struct v_state *v);
 int v_rfsh_scr(struct v_state *v);
+int v_damage(struct v_state *v, int y, int n);
+int v_redraw(struct v_state *v);
+
+/* src/screen.c */
+struct v_screen *v_scr_new(int fd);
+int v_scr_resize(struct v_screen *scr, int rows, int cols);
+int v_scr_invalidate(struct v_screen *scr);
+int v_scr_move(struct v_screen *scr, int y, int x);
+int v_scr_attr(struct v_screen *scr, int attr);
+int v_scr_put(struct v_screen *scr, const char *s, int len);
+int v_scr_clrtoeol(struct v_screen *scr);
+int v_scr_scroll(struct v_screen *scr, int top, int bot, int n);
+int v_scr_flush(struct v_screen *scr, int y, int x);
+int v_scr_free(struct v_screen *scr);
 
 /* src/fileio.c */
 int v_open(struct v_state *v, char *filename);
 int v_save(struct v_state *v);
+int v_save_snap(struct v_snap *snap, char *filename, int sync, bool mapped);
+
+/* src/scan.c */
+int v_scan_use(const char *name);
+char *v_scan_lines(char *p, char *end, bool last, struct v_line *lines,
+		   int max, int *n);
+char *v_index_lines(char *p, char *end, bool last, int threads,
+		    int (*fn)(void *arg, struct v_line *lines, int n),
+		    void *arg);
+
+/* src/saver.c */
+int v_snap_take(struct v_state *v, struct v_snap *snap);
+int v_snap_free(struct v_snap *snap);
+int v_save_start(struct v_state *v);
+int v_save_poll(struct v_state *v, bool wait);
+
+/* src/journal.c */
+int v_jrnl_open(struct v_state *v);
+int v_jrnl_add(struct v_state *v, int op, int y, int x, char *s, size_t len);
+bool v_jrnl_sync(struct v_state *v);
+int v_jrnl_mark(struct v_state *v);
+int v_jrnl_saved(struct v_state *v);
+int v_jrnl_stop(struct v_state *v);
+int v_jrnl_close(struct v_state *v);
+
+/* src/pager.c */
+int v_page_open(struct v_state *v, char *filename);
+int v_page_poll(struct v_state *v, bool wait);
+int v_page_progress(struct v_state *v);
+struct v_row *v_page_row(struct v_state *v, int y);
+int v_page_close(struct v_state *v);
+
+/* src/follow.c */
+int v_follow_start(struct v_state *v, char *filename);
+bool v_follow_poll(struct v_state *v);
+int v_follow_edit(struct v_state *v, int y);
+int v_follow_wait(struct v_state *v);
+int v_follow_stop(struct v_state *v);
+
+/* src/cache.c */
+int v_cache_load(struct v_state *v);
+int v_cache_store(struct v_state *v);
+
+/* src/loader.c */
+int v_load_start(struct v_state *v, char *filename);
+int v_load_poll(struct v_state *v, bool wait);
+int v_load_progress(struct v_state *v);
+int v_load_stop(struct v_state *v);
 
 /* src/editor.c */
 int v_insert(struct v_state *v, int c);
 int v_insert_nl(struct v_state *v);
 int v_bksp(struct v_state *v);
 int v_right_bksp(struct v_state *v);
+int v_paste(struct v_state *v, char *s, size_t len);
+int v_open_line(struct v_state *v, int y);
 
 /* src/row.c */
+int v_row_cx_to_rx(struct v_row *row, int cx);
+int v_row_rx_to_cx(struct v_row *row, int rx);
 int v_render_row(struct v_state *v, struct v_row *row);
 int v_insert_row(struct v_state *v, int y, char *s, size_t len);
+int v_insert_row_ref(struct v_state *v, int y, char *s, size_t len);
+int v_append_rows(struct v_state *v, struct v_line *lines, int n);
+int v_append_rows_ref(struct v_state *v, struct v_line *lines, int n);
+int v_insert_rows_ref(struct v_state *v, int y, struct v_line *lines, int n);
 int v_del_row(struct v_state *v, int y);
 int v_free_rows(struct v_state *v);
 int v_row_insert_char(struct v_state *v, struct v_row *row, int at, int c);
+int v_row_insert_str(struct v_state *v, struct v_row *row, int x, char *s,
+		     size_t len);
 int v_row_append_str(struct v_state *v, struct v_row *row, char *s, size_t len);
 int v_row_del_char(struct v_state *v, struct v_row *row, int x);
+int v_row_truncate(struct v_state *v, struct v_row *row, int at);
+int v_row_append_row(struct v_state *v, struct v_row *dst, struct v_row *src,
+		     int at);
+int v_row_seg(struct v_row *row, int i, char **s);
+
+/* src/tree.c */
+struct v_row *v_row_at(struct v_state *v, int y);
+struct v_row *v_tree_insert(struct v_state *v, int y);
+int v_tree_append(struct v_state *v, struct v_row *rows, int n);
+int v_tree_insert_rows(struct v_state *v, int y, struct v_row *rows, int n);
+int v_tree_delete(struct v_state *v, int y);
+int v_tree_free(struct v_state *v);
+
+/* src/arena.c */
+char *v_arena_add(struct v_blk **arena, char *s, size_t len);
+char *v_arena_line(struct v_blk **arena, char *s, size_t len);
+int v_arena_free(struct v_blk **arena);
+
+/* src/piece.c */
+char *v_pt_add(struct v_state *v, char *s, size_t len);
+int v_pt_insert(struct v_state *v, struct v_row *row, int x, char *s, int len);
+int v_pt_delete(struct v_state *v, struct v_row *row, int x, int len);
+int v_pt_append_row(struct v_state *v, struct v_row *dst, struct v_row *src,
+		    int at);
+int v_pt_free(struct v_state *v);
 
 #endif	/* VOID_H */
@@ -0,0 +1,122 @@
+/*
+ * arena.c - Append-only text storage routines
+ *
+ * This file provides the arenas text is bulk-allocated from. An arena is a
+ * chain of v_blk blocks which only ever grows: strings are copied at the end
+ * of the newest block, and a block is never moved nor written again once it
+ * is filled. Blocks grow geometrically up to V_ARENA_MAX, so storing the text
+ * of a whole file only costs a handful of allocations, and releasing it is a
+ * matter of freeing those blocks. Nothing is ever released on its own.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <void.h>
+
+static char *v_arena_alloc(struct v_blk **arena, size_t len)
+{
+	struct v_blk *blk = *arena;
+	if (!blk || blk->cap - blk->len < len) {
+		size_t cap = blk ? blk->cap * 2 : V_ADD_BLK;
+		if (cap > V_ARENA_MAX)
+			cap = V_ARENA_MAX;
+		if (cap < len)
+			cap = len;
+
+		blk = malloc(sizeof(struct v_blk) + cap);
+		if (!blk)
+			return NULL;
+
+		blk->next = *arena;
+		blk->len = 0;
+		blk->cap = cap;
+		*arena = blk;
+	}
+
+	char *p = &blk->data[blk->len];
+	blk->len += len;
+
+	return p;
+}
+
+/**
+ * v_arena_add - copy a string into an arena
+ * arena: Pointer to the newest block of the targeted arena.
+ * s: String to be copied.
+ * len: Length of string s.
+ *
+ * Copy a string at the end of an arena. A string which doesn't fit in the space
+ * left of the newest block starts a new one, twice as big as the previous one
+ * but no bigger than V_ARENA_MAX unless the string itself is. The returned
+ * address stays valid until v_arena_free() is called.
+ *
+ * Returns the address of the stored copy on success, NULL otherwise.
+ */
+char *v_arena_add(struct v_blk **arena, char *s, size_t len)
+{
+	if (!arena || !s || !len)
+		return NULL;
+
+	char *p = v_arena_alloc(arena, len);
+	if (p)
+		memcpy(p, s, len);
+
+	return p;
+}
+
+/**
+ * v_arena_line - copy a line into an arena along with a line terminator
+ * arena: Pointer to the newest block of the targeted arena.
+ * s: Line to be copied, without its line terminator.
+ * len: Length of line s.
+ *
+ * Copy a line at the end of an arena just like v_arena_add() does, followed
+ * by a '\n'. Lines copied one after the other thereby lie in the arena just
+ * like they do in a file, which lets v_snap_take() save them in one go.
+ *
+ * Returns the address of the stored copy on success, NULL otherwise.
+ */
+char *v_arena_line(struct v_blk **arena, char *s, size_t len)
+{
+	if (!arena || !s || !len)
+		return NULL;
+
+	char *p = v_arena_alloc(arena, len + 1);
+	if (p) {
+		memcpy(p, s, len);
+		p[len] = '\n';
+	}
+
+	return p;
+}
+
+/**
+ * v_arena_free - release every block of an arena
+ * arena: Pointer to the newest block of the targeted arena.
+ *
+ * Release every block of an arena in bulk. Nothing may refer to the text they
+ * hold anymore once this function is called. *arena will be setted to NULL.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_arena_free(struct v_blk **arena)
+{
+	if (!arena)
+		return V_ERR;
+
+	while (*arena) {
+		struct v_blk *next = (*arena)->next;
+		free(*arena);
+		*arena = next;
+	}
+
+	return V_OK;
+}
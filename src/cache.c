@@ -0,0 +1,314 @@
+/*
+ * cache.c - Line index cache routines
+ *
+ * This file keeps the line index of the read-only view across runs, so that
+ * reopening a huge file doesn't mean scanning it all over again. The index is
+ * stored inside a cache directory, in a file named after a hash of the full
+ * path of the indexed file, and records the inode, size and modification time
+ * the file had. An untouched file gets its index back without reading a single
+ * byte of it. A file which grew is taken as having had lines appended to it
+ * when the bytes found at its start, right before the end of the index and in
+ * a few blocks spread in between are still the same, and the indexing simply
+ * goes on from there. Those probes can't tell an append from a file which
+ * also had bytes changed elsewhere, outside of the probed blocks.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <void.h>
+
+static uint64_t v_cache_sum(const char *p, size_t len)
+{
+	uint64_t sum = 14695981039346656037ull;
+
+	/* FNV-1a */
+	for (size_t i = 0; i < len; i++) {
+		sum ^= (unsigned char)p[i];
+		sum *= 1099511628211ull;
+	}
+
+	return sum;
+}
+
+/* Sum of the V_CACHE_PROBE bytes found at off inside the file, 0 on error */
+static uint64_t v_cache_probe(int fd, off_t off, off_t end)
+{
+	char buf[V_CACHE_PROBE];
+	size_t len = end - off < V_CACHE_PROBE ? end - off : V_CACHE_PROBE;
+
+	if (pread(fd, buf, len, off) != (ssize_t)len)
+		return 0;
+
+	return v_cache_sum(buf, len);
+}
+
+/* Combined sums of the V_CACHE_SAMPLES probes spread evenly before scan */
+static uint64_t v_cache_spread(int fd, off_t scan)
+{
+	uint64_t sum = 0;
+
+	for (int i = 1; i <= V_CACHE_SAMPLES; i++) {
+		off_t off = scan / (V_CACHE_SAMPLES + 1) * i;
+		sum = sum * 1099511628211ull ^ v_cache_probe(fd, off, scan);
+	}
+
+	return sum;
+}
+
+static int v_cache_mkdir(char *dir)
+{
+	for (char *p = strchr(dir + 1, '/'); p; p = strchr(p + 1, '/')) {
+		*p = '\0';
+		int ret = mkdir(dir, 0700);
+		*p = '/';
+		if (ret == -1 && errno != EEXIST)
+			return V_ERR;
+	}
+
+	if (mkdir(dir, 0700) == -1 && errno != EEXIST)
+		return V_ERR;
+
+	return V_OK;
+}
+
+static char *v_cache_path(char *key, bool create)
+{
+	char *home = getenv("XDG_CACHE_HOME");
+	char *sub = "";
+	if (!home || home[0] != '/') {
+		home = getenv("HOME");
+		sub = "/.cache";
+	}
+	if (!home || home[0] != '/')
+		return NULL;
+
+	char *path = NULL;
+	if (asprintf(&path, "%s%s/%s", home, sub, V_CACHE_DIR) == -1)
+		return NULL;
+
+	if (create && v_cache_mkdir(path) == V_ERR) {
+		free(path);
+		return NULL;
+	}
+
+	char *file = NULL;
+	int ret = asprintf(&file, "%s/%016llx%s", path,
+			   (unsigned long long)v_cache_sum(key, strlen(key)),
+			   V_CACHE_EXT);
+	free(path);
+
+	return ret == -1 ? NULL : file;
+}
+
+static int v_cache_read(int fd, void *p, size_t len)
+{
+	return read(fd, p, len) == (ssize_t)len ? V_OK : V_ERR;
+}
+
+static bool v_cache_valid(struct v_pager *pg, struct v_cache_hdr *hdr,
+			  char *key, char *path, struct stat *st)
+{
+	if (memcmp(hdr->magic, V_CACHE_MAGIC, sizeof(hdr->magic)) ||
+	    strcmp(key, path) || hdr->ino != (uint64_t)st->st_ino ||
+	    hdr->every < 1 || hdr->nckpt < 0 || hdr->nlines < 0 ||
+	    hdr->line > hdr->scan || hdr->scan > (uint64_t)st->st_size)
+		return false;
+
+	/* Untouched since the index was stored */
+	if (hdr->size == (uint64_t)st->st_size &&
+	    hdr->sec == st->st_mtim.tv_sec && hdr->nsec == st->st_mtim.tv_nsec)
+		return true;
+
+	/* Otherwise only lines may have been appended, so it must have grown */
+	if (hdr->size >= (uint64_t)st->st_size)
+		return false;
+
+	off_t scan = hdr->scan;
+	off_t tail = scan > V_CACHE_PROBE ? scan - V_CACHE_PROBE : 0;
+
+	return hdr->head == v_cache_probe(pg->fd, 0, scan) &&
+	       hdr->tail == v_cache_probe(pg->fd, tail, scan) &&
+	       hdr->mid == v_cache_spread(pg->fd, scan);
+}
+
+/**
+ * v_cache_load - reuse the stored line index of the file being viewed
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Reuse the line index stored by v_cache_store() for the file opened in the
+ * read-only view, if any. The index is only taken when it was built for the
+ * very same file, and the file was either left untouched since then or grew
+ * while the blocks probed before the end of the index stayed the same. The
+ * indexing then goes on from where the stored index ends. Checkpoints are
+ * dropped as needed for the index to fit in the memory budget. Must be called
+ * before the indexing starts.
+ *
+ * Returns V_OK if the stored index was taken, V_ERR otherwise.
+ */
+int v_cache_load(struct v_state *v)
+{
+	if (!v || !v->pg || !v->filename)
+		return V_ERR;
+
+	struct v_pager *pg = v->pg;
+	char *key = realpath(v->filename, NULL);
+	char *file = key ? v_cache_path(key, false) : NULL;
+	char *path = NULL;
+	int ret = V_ERR;
+	int fd = file ? open(file, O_RDONLY) : -1;
+
+	struct v_cache_hdr hdr;
+	struct stat st;
+	if (fd == -1 || fstat(pg->fd, &st) == -1 ||
+	    v_cache_read(fd, &hdr, sizeof(hdr)) == V_ERR ||
+	    hdr.plen > PATH_MAX)
+		goto done;
+
+	path = calloc(1, hdr.plen + 1);
+	if (!path || v_cache_read(fd, path, hdr.plen) == V_ERR ||
+	    !v_cache_valid(pg, &hdr, key, path, &st))
+		goto done;
+
+	/* Keep every other checkpoint until they fit */
+	int every = hdr.every;
+	int keep = 1;
+	int nckpt = hdr.nckpt;
+	while (nckpt > pg->ckmax) {
+		every *= 2;
+		keep *= 2;
+		nckpt = (nckpt + 1) / 2;
+	}
+
+	off_t off = 0;
+	for (int i = 0; i < hdr.nckpt; i++) {
+		if (v_cache_read(fd, &off, sizeof(off)) == V_ERR)
+			goto done;
+		if (i % keep == 0)
+			pg->ckpt[i / keep] = off;
+	}
+
+	pg->every = every;
+	pg->nckpt = nckpt;
+	pg->nlines = hdr.nlines;
+	pg->scan = hdr.scan;
+	pg->line = hdr.line;
+	pg->cached = hdr.scan;
+	ret = V_OK;
+
+done:
+	if (fd != -1)
+		close(fd);
+	free(path);
+	free(file);
+	free(key);
+
+	return ret;
+}
+
+/**
+ * v_cache_store - store the line index of the file being viewed
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Store the line index of the file opened in the read-only view into the cache
+ * directory, for v_cache_load() to pick it up the next time the file is
+ * opened. The index file is written aside and renamed over the previous one,
+ * so that a crash never leaves a torn index behind. Nothing is written when
+ * the index didn't grow since it was loaded.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_cache_store(struct v_state *v)
+{
+	if (!v || !v->pg || !v->filename)
+		return V_ERR;
+
+	struct v_pager *pg = v->pg;
+	if (pg->err || pg->scan <= pg->cached)
+		return V_OK;
+
+	char *key = realpath(v->filename, NULL);
+	char *file = key ? v_cache_path(key, true) : NULL;
+	char *tmp = NULL;
+	int ret = V_ERR;
+	int fd = -1;
+
+	struct stat st;
+	if (!file || fstat(pg->fd, &st) == -1 ||
+	    asprintf(&tmp, "%s.XXXXXX", file) == -1) {
+		tmp = NULL;
+		goto done;
+	}
+
+	fd = mkstemp(tmp);
+	if (fd == -1)
+		goto done;
+
+	off_t scan = pg->scan;
+	off_t tail = scan > V_CACHE_PROBE ? scan - V_CACHE_PROBE : 0;
+	struct v_cache_hdr hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, V_CACHE_MAGIC, sizeof(hdr.magic));
+	hdr.ino = st.st_ino;
+	hdr.size = st.st_size;
+	hdr.sec = st.st_mtim.tv_sec;
+	hdr.nsec = st.st_mtim.tv_nsec;
+	hdr.scan = scan;
+	hdr.line = pg->line;
+	hdr.head = v_cache_probe(pg->fd, 0, scan);
+	hdr.tail = v_cache_probe(pg->fd, tail, scan);
+	hdr.mid = v_cache_spread(pg->fd, scan);
+	hdr.every = pg->every;
+	hdr.nckpt = pg->nckpt;
+	hdr.nlines = pg->nlines;
+	hdr.plen = strlen(key);
+
+	struct iovec iov[] = {
+		{&hdr, sizeof(hdr)},
+		{key, hdr.plen},
+		{pg->ckpt, sizeof(off_t) * pg->nckpt},
+	};
+	size_t len = iov[0].iov_len + iov[1].iov_len + iov[2].iov_len;
+	if (writev(fd, iov, 3) != (ssize_t)len)
+		goto done;
+
+	if (close(fd) == -1) {
+		fd = -1;
+		goto done;
+	}
+	fd = -1;
+
+	if (rename(tmp, file) == -1)
+		goto done;
+
+	pg->cached = scan;
+	ret = V_OK;
+
+done:
+	if (fd != -1)
+		close(fd);
+	if (ret == V_ERR && tmp)
+		unlink(tmp);
+	free(tmp);
+	free(file);
+	free(key);
+
+	return ret;
+}
@@ -19,7 +19,7 @@
 
 static void snap_cur_eol(struct v_state *v)
 {
-	struct v_row *row = (v->cur_y >= v->nrows) ? NULL : &v->rows[v->cur_y];
+	struct v_row *row = v_row_at(v, v->cur_y);
 	int len = row ? row->len : 0;
 	if (v->cur_x > len)
 		v->cur_x = len;
@@ -43,7 +43,7 @@ int v_cur_left(struct v_state *v)
 		v->cur_x--;
 	} else if (v->cur_y > 0) {
 		v->cur_y--;
-		v->cur_x = v->rows[v->cur_y].len;
+		v->cur_x = v_row_at(v, v->cur_y)->len;
 	}
 
 	snap_cur_eol(v);
@@ -65,7 +65,7 @@ int v_cur_left(struct v_state *v)
  */
 int v_cur_right(struct v_state *v)
 {
-	struct v_row *row = (v->cur_y >= v->nrows) ? NULL : &v->rows[v->cur_y];
+	struct v_row *row = v_row_at(v, v->cur_y);
 
 	if (row && v->cur_x < row->len) {
 		v->cur_x++;
@@ -147,7 +147,7 @@ int v_cur_bol(struct v_state *v)
  */
 int v_cur_eol(struct v_state *v)
 {
-	struct v_row *row = (v->cur_y >= v->nrows) ? NULL : &v->rows[v->cur_y];
+	struct v_row *row = v_row_at(v, v->cur_y);
 	if (v->cur_y < v->nrows)
 		v->cur_x = row->len;
 
@@ -204,12 +204,17 @@ int v_npage(struct v_state *v)
  *
  * Go to the bottom of the page. Nothing trivial, it simply changes the cursor
  * position values to the last line of currently opened buffer. The actual
- * screen update can only be seen once v_rfsh_scr() is called.
+ * screen update can only be seen once v_rfsh_scr() is called. A file still
+ * being loaded in the background, or indexed in the read-only view, is waited
+ * for, so that it really is the last line.
  *
  * Returns V_OK always.
  */
 int v_bottom_pg(struct v_state *v)
 {
+	v_load_poll(v, true);
+	v_page_poll(v, true);
+
 	v->cur_y = v->nrows - 1;
 	v->cur_x = 0;
 	return V_OK;
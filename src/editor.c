@@ -3,7 +3,8 @@
  *
  * Contains logic for character insertion, deletion, and line operations.
  * Unlike row.c, the routines available here operate at a higher level of
- * abstraction.
+ * abstraction. They are the ones keys edit the buffer through, and each of
+ * them journals the edit it carried out, see journal.c.
  *
  * Parts of this file are based on the kilo text editor by Salvatore Sanfilippo
  * and Paige Ruten (snaptoken)'s Build Your Own Text Editor booklet:
@@ -18,6 +19,7 @@
  */
 
 #include <stdbool.h>
+#include <string.h>
 
 #include <void.h>
 
@@ -35,7 +37,7 @@
  * 	2) Normal character insertion.
  *
  * If the cursor happens to be on the tilde line (past the file's EOL), a new
- * v_row struct will be appended into the v->rows array immediately allowing the
+ * v_row struct will be appended into the buffer immediately allowing the
  * insertion to be carried out. The editor dirty flag will be setted to true
  * after the operation. The main difference between v_insert() and
  * v_row_insert_char() would be that v_insert() is more oriented for the
@@ -50,13 +52,18 @@ int v_insert(struct v_state *v, int c)
 	if (!v)
 		return V_ERR;
 
-	if (v->cur_y == v->nrows)
+	bool eof = v->cur_y == v->nrows;
+	if (eof)
 		if (v_insert_row(v, v->nrows, "", 0) == V_ERR)
 			return V_ERR;
 
-	if (v_row_insert_char(v, &v->rows[v->cur_y], v->cur_x, c) == V_ERR)
-		return V_ERR;
+	if (v_row_insert_char(v, v_row_at(v, v->cur_y), v->cur_x, c) == V_ERR)
+		return eof ? v_jrnl_stop(v) : V_ERR;
+
+	char ch = c;
+	v_jrnl_add(v, V_JRNL_INSERT, v->cur_y, v->cur_x, &ch, 1);
 
+	v_follow_edit(v, v->cur_y);
 	v->cur_x++;
 	v->dirty = true;
 
@@ -69,11 +76,11 @@ int v_insert(struct v_state *v, int c)
  *
  * Insert a newline at the targeted v_state. Unlike v_insert() which focuses on
  * character insertion, this function focuses on inserting a brand new line into
- * the editor buffer, v->rows. There are two types of procedures will be done
+ * the editor buffer. There are two types of procedures will be done
  * here:
  *
  * 	1) If the cursor located at the beginning of a line, a new blank v_row
- * 	   struct will be appended into v->rows and that's it.
+ * 	   struct will be appended into the buffer and that's it.
  * 	2) If the cursor located in the middle of a line, this function shall
  * 	   splits it up into two different lines (two v_row structs).
  *
@@ -81,7 +88,7 @@ int v_insert(struct v_state *v, int c)
  * of the specified v_state's cursor x and y position. The editor dirty flag
  * will be sets to true automatically before this function exits. The given
  * v_state's cursor position also will be updated. The brand new inserted line
- * will also be renders automatically.
+ * will also be flagged for rendering automatically.
  *
  * Returns updated value of v->nrows on success, V_ERR otherwise.
  */
@@ -96,20 +103,23 @@ int v_insert_nl(struct v_state *v)
 		goto retval;
 	}
 
-	struct v_row *row = &v->rows[v->cur_y];
-	int stats = v_insert_row(v, v->cur_y + 1, &row->orig[v->cur_x],
-				 row->len - v->cur_x);
+	int stats = v_insert_row(v, v->cur_y + 1, "", 0);
 	if (stats == V_ERR)
 		return V_ERR;
 
-	row = &v->rows[v->cur_y];
-	row->len = v->cur_x;
-	row->orig[row->len] = '\0';
-	stats = v_render_row(v, row);
+	struct v_row *row = v_row_at(v, v->cur_y);
+	stats = v_row_append_row(v, v_row_at(v, v->cur_y + 1), row, v->cur_x);
 	if (stats == V_ERR)
-		return V_ERR;
+		return v_jrnl_stop(v);
+
+	stats = v_row_truncate(v, row, v->cur_x);
+	if (stats == V_ERR)
+		return v_jrnl_stop(v);
 
 retval:
+	v_jrnl_add(v, V_JRNL_NL, v->cur_y, v->cur_x, NULL, 0);
+	/* A line split at its start is only pushed down */
+	v_follow_edit(v, v->cur_x ? v->cur_y + 1 : v->cur_y);
 	v->dirty = true;
 	v->cur_y++;
 	v->cur_x = 0;
@@ -147,21 +157,33 @@ int v_bksp(struct v_state *v)
 	if (!v || v->cur_y == v->nrows || (v->cur_x == 0 && v->cur_y == 0))
 		return V_ERR;
 
-	struct v_row *row = &v->rows[v->cur_y];
+	struct v_row *row = v_row_at(v, v->cur_y);
 	if (v->cur_x > 0)
 		goto left_bksp;
 
-	v->cur_x = v->rows[v->cur_y - 1].len;
-	v_row_append_str(v, &v->rows[v->cur_y - 1], row->orig, row->len);
-	v_del_row(v, v->cur_y);
+	struct v_row *prev = v_row_at(v, v->cur_y - 1);
+	int len = prev->len;
+	if (v_row_append_row(v, prev, row, 0) == V_ERR) {
+		/* Part of the line may have made it already */
+		if (prev->len != len && v_row_truncate(v, prev, len) == V_ERR)
+			return v_jrnl_stop(v);
+		return V_ERR;
+	}
+	if (v_del_row(v, v->cur_y) == V_ERR)
+		return v_jrnl_stop(v);
+	v_jrnl_add(v, V_JRNL_BKSP, v->cur_y, 0, NULL, 0);
+	v->cur_x = len;
 	v->cur_y--;
 	v->dirty = true;
+	v_follow_edit(v, v->cur_y);
 
 	return v->cur_y;
 
 left_bksp:
 	if (v_row_del_char(v, row, v->cur_x - 1) == V_ERR)
 		return V_ERR;
+	v_jrnl_add(v, V_JRNL_BKSP, v->cur_y, v->cur_x, NULL, 0);
+	v_follow_edit(v, v->cur_y);
 	v->cur_x--;
 	v->dirty = true;
 
@@ -187,3 +209,122 @@ int v_right_bksp(struct v_state *v)
 
 	return V_OK;
 }
+
+/**
+ * v_paste - insert a block of text at the targeted v_state
+ * v: Pointer to the targeted v_state struct.
+ * s: The text to be inserted, its lines ended by '\n'.
+ * len: Length of text s.
+ *
+ * Insert a whole block of text at the current cursor position in one go, as
+ * pasting it does. Text without any '\n' is simply inserted into the current
+ * line. Otherwise, the current line is split at the cursor, its head getting
+ * the first line of the text and its tail going after the last one. The text
+ * past the first line is copied once into the arena (or the add buffer in
+ * piece table mode) and split at its line terminators in a single pass, every
+ * line becoming a new row borrowing its text from the copy. The rows go into
+ * the row tree a whole leaf at a time, through v_insert_rows_ref(). None of
+ * the rows is rendered here, each one only gets rendered once drawn. The
+ * whole paste is journaled as a single record. The editor dirty flag will be
+ * setted to true and the cursor ends up right after the inserted text.
+ *
+ * Returns the updated value of v->nrows on success, V_ERR otherwise.
+ */
+int v_paste(struct v_state *v, char *s, size_t len)
+{
+	struct v_line lines[V_PASTE_BATCH];
+
+	if (!v || (!s && len))
+		return V_ERR;
+
+	if (!len)
+		return v->nrows;
+
+	bool eof = v->cur_y == v->nrows;
+	if (eof)
+		if (v_insert_row(v, v->nrows, "", 0) == V_ERR)
+			return V_ERR;
+
+	int y = v->cur_y;
+	int x = v->cur_x;
+	struct v_row *row = v_row_at(v, y);
+	char *nl = memchr(s, '\n', len);
+	if (!nl) {
+		if (v_row_insert_str(v, row, x, s, len) == V_ERR)
+			return eof ? v_jrnl_stop(v) : V_ERR;
+		v_jrnl_add(v, V_JRNL_PASTE, y, x, s, len);
+		v_follow_edit(v, y);
+		v->dirty = true;
+		v->cur_x += len;
+		return v->nrows;
+	}
+
+	/* The first line goes straight into the current row */
+	size_t rest = s + len - (nl + 1);
+	char *text = "";
+	if (rest) {
+		text = v->pt ? v_pt_add(v, nl + 1, rest) :
+			       v_arena_add(&v->arena, nl + 1, rest);
+		if (!text)
+			return eof ? v_jrnl_stop(v) : V_ERR;
+	}
+
+	char *end = text + rest;
+	char *last = end;
+	while (last > text && last[-1] != '\n')
+		last--;
+
+	/* The tail of the current line goes after the last line */
+	if (v_insert_row_ref(v, y + 1, last, end - last) == V_ERR)
+		return eof ? v_jrnl_stop(v) : V_ERR;
+
+	row = v_row_at(v, y);
+	if (v_row_append_row(v, v_row_at(v, y + 1), row, x) == V_ERR ||
+	    v_row_truncate(v, row, x) == V_ERR ||
+	    v_row_append_str(v, row, s, nl - s) == V_ERR)
+		return v_jrnl_stop(v);
+
+	char *p = text;
+	int n = 0;
+	do {
+		p = v_scan_lines(p, last, false, lines, V_PASTE_BATCH, &n);
+		if (v_insert_rows_ref(v, y + 1, lines, n) == V_ERR)
+			return v_jrnl_stop(v);
+		y += n;
+	} while (n == V_PASTE_BATCH);
+
+	v_jrnl_add(v, V_JRNL_PASTE, v->cur_y, x, s, len);
+	v->dirty = true;
+	v->cur_y = y + 1;
+	v->cur_x = end - last;
+	v_follow_edit(v, v->cur_y);
+
+	return v->nrows;
+}
+
+/**
+ * v_open_line - open a blank line at the targeted v_state
+ * v: Pointer to the targeted v_state struct.
+ * y: The line number of the new line.
+ *
+ * Open a blank line at line y, pushing the line found there and every line
+ * after it one line down, as the o and O commands do. The cursor is left
+ * alone, moving it onto the new line is up to the caller. The editor dirty
+ * flag will be setted to true.
+ *
+ * Returns the updated value of v->nrows on success, V_ERR otherwise.
+ */
+int v_open_line(struct v_state *v, int y)
+{
+	if (!v || y < 0 || y > v->nrows)
+		return V_ERR;
+
+	if (v_insert_row(v, y, "", 0) == V_ERR)
+		return V_ERR;
+
+	v_jrnl_add(v, V_JRNL_OPEN, y, 0, NULL, 0);
+	v_follow_edit(v, y);
+	v->dirty = true;
+
+	return v->nrows;
+}
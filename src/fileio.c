@@ -30,6 +30,8 @@
 #include <unistd.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 
 #include <void.h>
 
@@ -39,136 +41,244 @@
  * filename: The name of the targeted file.
  *
  * Open a file and load its content into the editor buffer. If the target file
- * does not exist, nothing will be saved into v->rows array. Otherwise, all of
- * the file content will be saved into v->rows array and ready for any kinds of
- * text manipulation.
+ * does not exist, nothing will be saved into the buffer. Otherwise, all of
+ * the file content will be saved into the buffer and ready for any kinds of
+ * text manipulation. This is the synchronous version of v_load_start(): the
+ * loader thread is started the very same way, then waited for until the last
+ * line of the file is appended. In piece table mode, the rows refer to the
+ * read-only v->src buffer the file is read into, and in memory mapped file
+ * mode to the mapping of the file. A row only gets a copy of its own text once
+ * it is edited.
  *
  * Returns V_OK on success, V_ERR otherwise.
  */
 int v_open(struct v_state *v, char *filename)
 {
-	v->filename = strdup(filename);
-	if (!v->filename)
-		return V_ERR;
+	int ret = v_load_start(v, filename);
+	if (v_load_poll(v, true) == V_ERR)
+		ret = V_ERR;
 
-	FILE *fp = fopen(filename, "r");
-	if (!fp)
-		return V_ERR;
+	return ret;
+}
 
-	char *s = NULL;
-	size_t cap = 0;
-	ssize_t len = 0;
-	while ((len = getline(&s, &cap, fp)) != -1) {
-		while (len > 0 && (s[len - 1] == '\n' || s[len - 1] == '\r'))
-			len--;
-		if (v_insert_row(v, v->nrows, s, len) == V_ERR)
-			goto error;
-	}
+static int v_save_flush(int fd, struct iovec *iov, int n)
+{
+	while (n > 0) {
+		ssize_t w = writev(fd, iov, n);
+		if (w == -1 && errno == EINTR)
+			continue;
+		if (w == -1)
+			return V_ERR;
+		if (w == 0) {
+			errno = EIO;
+			return V_ERR;
+		}
 
-	fclose(fp);
-	fp = NULL;
-	free(s);
-	s = NULL;
-	v->dirty = false;
+		/* Pick up where a short write left off */
+		while (n > 0 && (size_t)w >= iov->iov_len) {
+			w -= iov->iov_len;
+			iov++;
+			n--;
+		}
+		if (n > 0) {
+			iov->iov_base = (char *)iov->iov_base + w;
+			iov->iov_len -= w;
+		}
+	}
 
 	return V_OK;
+}
 
-error:
-	fclose(fp);
-	fp = NULL;
-	free(s);
-	s = NULL;
-	v->dirty = false;
+static int v_save_rows(struct v_snap *snap, int fd)
+{
+	for (size_t i = 0; i < snap->n; i += V_SAVE_IOV) {
+		size_t left = snap->n - i;
+		int n = left < V_SAVE_IOV ? left : V_SAVE_IOV;
 
-	return V_ERR;
+		if (v_save_flush(fd, &snap->iov[i], n) == V_ERR)
+			return V_ERR;
+	}
+
+	return V_OK;
 }
 
-static char *v_rows_to_str(struct v_state *v, int *buf_len)
+static int v_save_tmp(char *path, struct stat *st, char **tmp)
 {
-	int i = 0;
-	int total_len = 0;
-
-	for (i = 0; i < v->nrows; i++)
-		total_len += v->rows[i].len + 1;
-	*buf_len = total_len;
-
-	char *buf = malloc(sizeof(char) * total_len);
-	if (!buf)
-		return NULL;
-
-	char *p = buf;
-	for (i = 0; i < v->nrows; i++) {
-		memcpy(p, v->rows[i].orig, v->rows[i].len);
-		p += v->rows[i].len;
-		*p = '\n';
-		p++;
+	size_t n = strlen(path) + sizeof(".XXXXXX");
+	*tmp = malloc(n);
+	if (!*tmp)
+		return -1;
+	snprintf(*tmp, n, "%s.XXXXXX", path);
+
+	int fd = mkstemp(*tmp);
+	if (fd == -1) {
+		free(*tmp);
+		*tmp = NULL;
+		return -1;
 	}
 
-	return buf;
+	/* Owner first, since chown() may clear the set-user-ID bits */
+	if (st) {
+		if (fchown(fd, st->st_uid, st->st_gid) == -1)
+			fchown(fd, -1, st->st_gid);
+		fchmod(fd, st->st_mode & 07777);
+	} else {
+		mode_t mask = umask(0);
+		umask(mask);
+		fchmod(fd, V_FILE_MODE & ~mask);
+	}
+
+	return fd;
+}
+
+static int v_save_sync_dir(char *path)
+{
+	char *slash = strrchr(path, '/');
+	char *dir = slash ? strndup(path, slash - path + 1) : strdup(".");
+	if (!dir)
+		return V_ERR;
+
+	int fd = open(dir, O_RDONLY | O_DIRECTORY);
+	free(dir);
+	if (fd == -1)
+		return V_ERR;
+
+	/* Some file systems can't sync a directory, nothing to be done then */
+	int ret = fsync(fd) == -1 && errno != EINVAL ? V_ERR : V_OK;
+	close(fd);
+
+	return ret;
 }
 
 /**
- * v_save - save file to disk
- * v: Pointer to the targeted v_state struct.
+ * v_save_snap - write a snapshot of the buffer content into a file
+ * snap: Pointer to the snapshot to be written.
+ * filename: The name of the targeted file.
+ * sync: fsync() policy, one of the V_SYNC_* values.
+ * mapped: Whether rows still refer to a mapping of the file.
  *
- * Save file to disk. This function will converts the entire file content into
- * one long ass piece of string. Once converted this function will dumps
- * everything out into that file and thereby saving it. After the saving part is
- * done without any errors occured, the editor dirty flag will flicks
- * automatically to false. Signaling that all changes have been saved. Do note
- * that, this function is intended to be use while the editor curses window
- * still on.
+ * Write a snapshot taken by v_snap_take() into a file. The pieces of text of
+ * the snapshot are handed to writev(), up to V_SAVE_IOV of them at a time, so
+ * writing takes no more memory however large the buffer is. The content is
+ * written into a temporary file next to the original one, which takes over
+ * its mode and ownership, and is then renamed over it. A crash or a full disk
+ * halfway through thereby never leaves a truncated file behind. The file is
+ * fsync()ed before being renamed, and its directory afterward, according to
+ * sync. A file with several hard links is written in place instead, so that
+ * the links stay, and so is a file whose directory doesn't let a temporary
+ * file in, unless mapped is true, in which case writing into it would change
+ * the text of the rows under their feet. This function touches no v_state
+ * struct, so that it can run on a thread of its own. The snapshot is
+ * consumed.
  *
- * Returns V_OK alongside with a status message saying that the changes have
- * been written out successfully, an error message will be displays and V_ERR
- * will be returns otherwise.
+ * Returns V_OK on success, V_ERR with errno set otherwise.
  */
-int v_save(struct v_state *v)
+int v_save_snap(struct v_snap *snap, char *filename, int sync, bool mapped)
 {
-	if (!v)
+	/* Replace the file a symbolic link points to, not the link */
+	char *path = realpath(filename, NULL);
+	if (!path)
+		path = strdup(filename);
+	if (!path)
 		return V_ERR;
 
-	if (!v->filename) {
-		v->filename = v_prompt(v, "Save as: %s");
-		if (!v->filename)
-			return V_ERR;
+	struct stat st;
+	bool exists = stat(path, &st) == 0;
+	char *tmp = NULL;
+	int fd = -1;
+	int err = 0;
+
+	/*
+	 * Writing in place would break the other hard links to the file and
+	 * the rows referring to its mapping, but a directory which can't hold
+	 * a temporary file leaves no choice.
+	 */
+	if (!exists || st.st_nlink == 1 || mapped) {
+		fd = v_save_tmp(path, exists ? &st : NULL, &tmp);
+		if (fd == -1 && (errno != EACCES || mapped))
+			goto error;
 	}
+	if (fd == -1)
+		fd = open(path, O_WRONLY | O_CREAT, V_FILE_MODE);
+	if (fd == -1)
+		goto error;
 
-	int fd = 0;
-	char *content = NULL;
-	int len = 0;
+	if (v_save_rows(snap, fd) == V_ERR)
+		goto error;
 
-	content = v_rows_to_str(v, &len);
-	if (!content)
-		return V_ERR;
+	if (!tmp && ftruncate(fd, snap->len) == -1)
+		goto error;
 
-	fd = open(v->filename, O_RDWR | O_CREAT, V_FILE_MODE);
-	if (fd == -1)
-		goto cleanup;
+	if (sync != V_SYNC_NONE && fsync(fd) == -1)
+		goto error;
 
-	if (ftruncate(fd, len) == -1)
-		goto cleanup;
+	/* Write errors may only show up here on network file systems */
+	int ret = close(fd);
+	fd = -1;
+	if (ret == -1)
+		goto error;
 
-	if (write(fd, content, len) != len)
-		goto cleanup;
+	if (tmp && rename(tmp, path) == -1)
+		goto error;
 
-	close(fd);
-	free(content);
-	content = NULL;
-	v->dirty = false;
+	if (tmp && sync == V_SYNC_FULL && v_save_sync_dir(path) == V_ERR)
+		goto error;
 
-	v_set_stats_msg(v, "%dL %dB written out to disk", v->nrows, len);
+	free(tmp);
+	tmp = NULL;
+	free(path);
+	path = NULL;
 
 	return V_OK;
 
-cleanup:
-	v_set_stats_msg(v, "ERR: %s", strerror(errno));
-
+error:
+	err = errno;
 	if (fd != -1)
 		close(fd);
-	free(content);
-	content = NULL;
-	v->dirty = true;
+	if (tmp)
+		unlink(tmp);
+	free(tmp);
+	tmp = NULL;
+	free(path);
+	path = NULL;
+	errno = err;
 
 	return V_ERR;
 }
+
+/**
+ * v_save - save file to disk
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Save file to disk. A snapshot of the buffer content is taken and handed
+ * over to v_save_start(), which writes it in the background through
+ * v_save_snap() while the editing goes on. The outcome is reported by
+ * v_save_poll() once the writing is done. The editor dirty flag flicks to
+ * false right away, any edit made meanwhile turning it back on, and so does a
+ * failed save. Do note that, this function is intended to be use while the
+ * editor curses window still on.
+ *
+ * Returns V_OK if the saving was started, an error message will be displays
+ * and V_ERR will be returns otherwise.
+ */
+int v_save(struct v_state *v)
+{
+	if (!v)
+		return V_ERR;
+
+	/* Never save half of a file */
+	v_load_poll(v, true);
+
+	if (!v->filename) {
+		v->filename = v_prompt(v, "Save as: %s");
+		if (!v->filename)
+			return V_ERR;
+	}
+
+	if (v_save_start(v) == V_ERR) {
+		v_set_stats_msg(v, "ERR: %s", strerror(errno));
+		return V_ERR;
+	}
+
+	return V_OK;
+}
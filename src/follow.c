@@ -0,0 +1,350 @@
+/*
+ * follow.c - Follow mode routines
+ *
+ * This file provides the follow mode, which keeps appending the lines written
+ * to a growing file, or coming down a pipe on stdin, to the end of the row
+ * tree, just like tail -f does. The followed file is never read in one go:
+ * whatever was written since the last time is read and split into rows every
+ * time the editor goes around its main loop, a line still being written
+ * showing up as the last row and growing along. While waiting for a key, the
+ * editor also waits for the file to grow, through inotify when possible and
+ * by polling it every V_FOLLOW_POLL ms otherwise.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+#include <void.h>
+
+static int v_follow_add(struct v_state *v, struct v_follow *fw, bool last)
+{
+	static struct v_line lines[V_LOAD_BATCH];
+	char *p = fw->buf;
+	char *end = fw->buf + fw->len;
+
+	/* A '\r' may be the first half of a "\r\n" still to come */
+	if (!last && end > p && end[-1] == '\r')
+		end--;
+
+	if (fw->open && p < end) {
+		char *nl = memchr(p, '\n', end - p);
+		size_t len = (nl ? nl : end) - p;
+		if (nl && len && nl[-1] == '\r')
+			len--;
+
+		struct v_row *row = v_row_at(v, v->nrows - 1);
+		if (len && v_row_append_str(v, row, p, len) == V_ERR)
+			return V_ERR;
+
+		fw->open = !nl;
+		p = nl ? nl + 1 : end;
+	}
+
+	int n = 0;
+	do {
+		p = v_scan_lines(p, end, false, lines, V_LOAD_BATCH, &n);
+		if (v_append_rows(v, lines, n) == V_ERR)
+			return V_ERR;
+	} while (n == V_LOAD_BATCH);
+
+	/* The line being written shows up as it is for now */
+	if (p < end) {
+		struct v_line line = {p, end - p};
+		if (v_append_rows(v, &line, 1) == V_ERR)
+			return V_ERR;
+		fw->open = true;
+	}
+
+	fw->len = fw->buf + fw->len - end;
+	if (fw->len)
+		fw->buf[0] = '\r';
+
+	return V_OK;
+}
+
+static void v_follow_drain(struct v_follow *fw)
+{
+	char buf[sizeof(struct inotify_event) * 16];
+
+	while (fw->ino != -1 && read(fw->ino, buf, sizeof(buf)) > 0)
+		;
+}
+
+static int v_follow_read(struct v_state *v, struct v_follow *fw)
+{
+	struct stat st;
+
+	/* Start over from the top of a file truncated under our feet */
+	if (!fw->pipe && fstat(fw->fd, &st) == 0 && st.st_size < fw->off) {
+		if (lseek(fw->fd, 0, SEEK_SET) == -1)
+			return V_ERR;
+		fw->off = 0;
+		fw->len = 0;
+		fw->open = false;
+		v_set_stats_msg(v, "%s: file truncated, earlier lines kept",
+				v->filename ? v->filename : "[No Name]");
+	}
+
+	fw->backlog = false;
+	for (int i = 0; i < V_FOLLOW_SLICE; i++) {
+		ssize_t n = read(fw->fd, fw->buf + fw->len,
+				 V_READ_BLK - fw->len);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1 && errno == EAGAIN)
+			return V_OK;
+		if (n == -1)
+			return V_ERR;
+
+		/* A regular file may still grow, a pipe is done for good */
+		if (n == 0 && fw->pipe)
+			fw->eof = true;
+		if (n == 0)
+			return v_follow_add(v, fw, fw->eof);
+
+		fw->len += n;
+		fw->off += n;
+		if (v_follow_add(v, fw, false) == V_ERR)
+			return V_ERR;
+	}
+
+	/* Leave the rest for later and let the editor breathe */
+	fw->backlog = true;
+
+	return V_OK;
+}
+
+/**
+ * v_follow_start - start following a growing file or stdin
+ * v: Pointer to the targeted v_state struct.
+ * filename: The name of the targeted file, NULL to follow stdin.
+ *
+ * Start following a growing file, or the pipe found on stdin when filename is
+ * NULL. Its lines are appended to the row tree by v_follow_poll() as they get
+ * written, starting with the ones already there. When following stdin, the
+ * pipe is moved to another descriptor and stdin is reopened on the terminal,
+ * for the keys to be read from there: this must be done before the curses
+ * mode is initialized.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_follow_start(struct v_state *v, char *filename)
+{
+	if (!v || v->fw)
+		return V_ERR;
+
+	struct v_follow *fw = calloc(1, sizeof(struct v_follow));
+	if (!fw)
+		return V_ERR;
+
+	fw->fd = -1;
+	fw->ino = -1;
+	fw->buf = malloc(V_READ_BLK);
+	if (!fw->buf)
+		goto error;
+
+	if (filename) {
+		v->filename = strdup(filename);
+		if (!v->filename)
+			goto error;
+		fw->fd = open(filename, O_RDONLY);
+	} else {
+		fw->fd = dup(STDIN_FILENO);
+		int tty = open("/dev/tty", O_RDONLY);
+		if (tty == -1 || dup2(tty, STDIN_FILENO) == -1) {
+			if (tty != -1)
+				close(tty);
+			goto error;
+		}
+		close(tty);
+	}
+
+	struct stat st;
+	if (fw->fd == -1 || fstat(fw->fd, &st) == -1)
+		goto error;
+
+	fw->pipe = !S_ISREG(st.st_mode);
+	if (fw->pipe &&
+	    fcntl(fw->fd, F_SETFL, fcntl(fw->fd, F_GETFL) | O_NONBLOCK) == -1)
+		goto error;
+
+	/* Fall back to polling when the file can't be watched */
+	if (!fw->pipe && filename) {
+		fw->ino = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fw->ino != -1 &&
+		    inotify_add_watch(fw->ino, filename, IN_MODIFY) == -1) {
+			close(fw->ino);
+			fw->ino = -1;
+		}
+	}
+
+	v->fw = fw;
+
+	return V_OK;
+
+error:
+	if (fw->fd != -1)
+		close(fw->fd);
+	free(fw->buf);
+	free(fw);
+
+	return V_ERR;
+}
+
+/**
+ * v_follow_poll - append the lines written to the followed file so far
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Append the lines written to the followed file since the last call to the
+ * end of the row tree, leaving the editor dirty flag as it was. Text written
+ * after the last line terminator goes to the last row, which keeps growing
+ * until its line is done or the row gets edited, see v_follow_edit(). At most
+ * V_FOLLOW_SLICE blocks are read per call, and fw->backlog tells whether more
+ * of them may already be waiting. A cursor sitting on the last row is kept
+ * there, so that the view sticks to the end of the file. Nothing happens when
+ * no file is followed.
+ *
+ * Returns whether the screen needs to be refreshed: it doesn't when the last
+ * wait only ended because the file grew, and all of the new text went below
+ * the screen.
+ */
+bool v_follow_poll(struct v_state *v)
+{
+	if (!v || !v->fw)
+		return true;
+
+	struct v_follow *fw = v->fw;
+	bool redraw = !fw->idle;
+	fw->idle = false;
+	if (fw->eof)
+		return redraw;
+
+	v_follow_drain(fw);
+
+	off_t off = fw->off;
+	int nrows = v->nrows;
+	int first = fw->open ? nrows - 1 : nrows;
+	bool stick = v->cur_y >= nrows - 1;
+	bool dirty = v->dirty;
+	if (v_follow_read(v, fw) == V_ERR) {
+		v_set_stats_msg(v, "ERR: %s", strerror(errno));
+		fw->eof = true;
+		redraw = true;
+	}
+	v->dirty = dirty;
+
+	/* The status bar has to tell a pipe is closed */
+	if (fw->off == off && v->nrows == nrows)
+		return redraw || fw->eof;
+
+	if (stick && v->cur_y != v->nrows - 1) {
+		v->cur_y = v->nrows - 1;
+		v->cur_x = 0;
+	}
+
+	return redraw || stick || first < v->rowoff + v->scr_y;
+}
+
+/**
+ * v_follow_edit - keep the followed lines off the edited rows
+ * v: Pointer to the targeted v_state struct.
+ * y: The last row the edit went through, once done.
+ *
+ * Tell that the rows up to y were just edited. Once the row holding a line
+ * still being written is edited, moved away from the end or deleted, the rest
+ * of that line starts a new row instead of going to whatever row is last now.
+ * Nothing happens when no file is followed.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_follow_edit(struct v_state *v, int y)
+{
+	if (!v)
+		return V_ERR;
+
+	/* Edits that end above it leave the last row as it was */
+	if (v->fw && y >= v->nrows - 1)
+		v->fw->open = false;
+
+	return V_OK;
+}
+
+/**
+ * v_follow_wait - wait for a key or for the followed file to grow
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Wait until either a key is pressed or the followed file grows, whichever
+ * comes first. The file is watched through inotify when possible, polled every
+ * V_FOLLOW_POLL ms otherwise, and a pipe is simply waited on. Nothing is
+ * waited for when more text is already known to be waiting.
+ *
+ * Returns the delay to give timeout() for reading the next key.
+ */
+int v_follow_wait(struct v_state *v)
+{
+	if (!v || !v->fw)
+		return -1;
+
+	struct v_follow *fw = v->fw;
+	if (fw->backlog)
+		return 0;
+
+	struct pollfd pfd[2] = {
+		{STDIN_FILENO, POLLIN, 0},
+		{fw->pipe ? fw->fd : fw->ino, POLLIN, 0},
+	};
+	int n = fw->eof || pfd[1].fd == -1 ? 1 : 2;
+	int ms = fw->eof || fw->pipe || fw->ino != -1 ? -1 : V_FOLLOW_POLL;
+
+	/* A SIGWINCH gets the screen refreshed as a key would */
+	if (poll(pfd, n, ms) == -1)
+		return 0;
+	if (pfd[0].revents)
+		return -1;
+
+	fw->idle = true;
+
+	return 0;
+}
+
+/**
+ * v_follow_stop - stop following the followed file
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Stop following the followed file. The rows appended so far are kept. Does
+ * nothing when no file is followed.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_follow_stop(struct v_state *v)
+{
+	if (!v)
+		return V_ERR;
+
+	struct v_follow *fw = v->fw;
+	if (!fw)
+		return V_OK;
+
+	if (fw->ino != -1)
+		close(fw->ino);
+	close(fw->fd);
+	free(fw->buf);
+	free(fw);
+	v->fw = NULL;
+
+	return V_OK;
+}
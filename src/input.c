@@ -23,14 +23,225 @@
  * It is licensed under MIT License. See the LICENSE file for details.
  */
 
+#define _GNU_SOURCE
+
 #include <stddef.h>
 #include <ncurses.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
+#include <time.h>
+#include <limits.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
 
 #include <void.h>
 
+/* === Bracketed paste related === */
+
+/*
+ * Swaps stdin for a pipe holding the first n bytes of s, so that curses reads
+ * those instead of the terminal. Returns the terminal fd to put back with
+ * v_paste_unplug(), or -1 if stdin was left alone.
+ */
+static int v_paste_plug(const char *s, size_t n)
+{
+	int plug[2];
+	int tty = dup(STDIN_FILENO);
+	if (tty == -1)
+		return -1;
+	if (pipe(plug) == -1) {
+		close(tty);
+		return -1;
+	}
+
+	/* An empty pipe takes PIPE_BUF bytes without blocking */
+	if (n > PIPE_BUF)
+		n = PIPE_BUF;
+	if (n && write(plug[1], s, n) == -1)
+		n = 0;
+
+	close(plug[1]);
+	dup2(plug[0], STDIN_FILENO);
+	close(plug[0]);
+
+	return tty;
+}
+
+static void v_paste_unplug(int tty)
+{
+	if (tty == -1)
+		return;
+
+	dup2(tty, STDIN_FILENO);
+	close(tty);
+}
+
+/*
+ * Takes the keys curses already read from the terminal, which come before the
+ * rest of the paste. Curses reads from an empty pipe meanwhile, so that
+ * nothing but what it holds is taken one byte at a time. Returns whether the
+ * paste end was among them.
+ */
+static bool v_paste_drain(char *buf, size_t cap, size_t *n)
+{
+	int tty = v_paste_plug(NULL, 0);
+
+	/* Keep "\r\n" apart from an empty line */
+	nonl();
+	timeout(0);
+
+	bool end = false;
+	int c = 0;
+	while (*n < cap && (c = getch()) != ERR) {
+		end = c == V_KEY_PASTE_END;
+		if (end)
+			break;
+		if (c <= UCHAR_MAX)
+			buf[(*n)++] = c;
+	}
+
+	timeout(-1);
+	nl();
+	v_paste_unplug(tty);
+
+	return end;
+}
+
+/*
+ * Hands the bytes read past the paste end back to curses as keys. They go
+ * through curses from a pipe first, as ungetch() would give back the bytes of
+ * an arrow key one by one. What does not fit in the pipe or in the curses
+ * queue is lost, which takes a lot of typing ahead of a paste.
+ */
+static void v_paste_rest(const char *s, size_t n)
+{
+	if (!n)
+		return;
+
+	int *keys = malloc(sizeof(*keys) * n);
+	if (!keys)
+		return;
+
+	int tty = v_paste_plug(s, n);
+	size_t nkeys = 0;
+	int c = 0;
+	if (tty != -1) {
+		timeout(0);
+		while (nkeys < n && (c = getch()) != ERR)
+			keys[nkeys++] = c;
+		timeout(-1);
+		v_paste_unplug(tty);
+	}
+
+	while (nkeys)
+		ungetch(keys[--nkeys]);
+	free(keys);
+}
+
+/* Turns line terminators into '\n' and leaves control chars out, in place */
+static size_t v_paste_clean(char *buf, size_t n)
+{
+	size_t len = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		unsigned char c = buf[i];
+		if (c == V_KEY_RET && i + 1 < n && buf[i + 1] == V_KEY_NL)
+			continue;
+		if (c == V_KEY_RET)
+			c = V_KEY_NL;
+		if ((c < ' ' && c != '\t' && c != V_KEY_NL) || c == 0177)
+			continue;
+		buf[len++] = c;
+	}
+
+	return len;
+}
+
+/*
+ * Returns the pasted text, its line terminators turned into '\n'. Once what
+ * curses already holds is taken, the rest is read straight from the terminal
+ * in blocks, up to the paste end sequence. The keys typed after it are handed
+ * back to curses.
+ */
+static char *v_paste_read(size_t *len)
+{
+	size_t cap = V_READ_BLK;
+	size_t n = 0;
+	size_t seq = strlen(V_PASTE_END);
+	char *buf = malloc(cap);
+	if (!buf)
+		return NULL;
+
+	bool end = v_paste_drain(buf, cap, &n);
+	while (!end) {
+		if (n == cap) {
+			char *tmp = realloc(buf, cap * 2);
+			if (!tmp) {
+				free(buf);
+				return NULL;
+			}
+			buf = tmp;
+			cap *= 2;
+		}
+
+		/* Cut a never ending paste */
+		struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+		int ready = poll(&pfd, 1, V_PASTE_WAIT);
+		if (ready == -1 && errno == EINTR)
+			continue;
+		if (ready <= 0)
+			break;
+
+		ssize_t got = read(STDIN_FILENO, buf + n, cap - n);
+		if (got == -1 && errno == EINTR)
+			continue;
+		if (got <= 0)
+			break;
+
+		/* The end sequence may have started in the previous block */
+		size_t from = n > seq - 1 ? n - (seq - 1) : 0;
+		n += got;
+		char *e = memmem(buf + from, n - from, V_PASTE_END, seq);
+		if (!e)
+			continue;
+
+		v_paste_rest(e + seq, buf + n - (e + seq));
+		n = e - buf;
+		end = true;
+	}
+
+	*len = v_paste_clean(buf, n);
+
+	return buf;
+}
+
+static int v_paste_input(struct v_state *v)
+{
+	size_t len = 0;
+	char *buf = v_paste_read(&len);
+	if (!buf)
+		return V_ERR;
+
+	int ret = v_paste(v, buf, len);
+	free(buf);
+
+	return ret == V_ERR ? V_ERR : V_OK;
+}
+
+/* Only insert mode takes pastes, the text must not run as commands */
+static int v_paste_skip(struct v_state *v)
+{
+	size_t len = 0;
+	free(v_paste_read(&len));
+	if (!v->view)
+		v_set_stats_msg(v, "Paste left out. Press i to paste.");
+
+	return V_OK;
+}
+
 /* === Global keys === */
 
 static const struct v_key global_keys[] = {
@@ -69,6 +280,9 @@ static int v_cur_pos(struct v_state *v)
 
 static int v_quit(struct v_state *v)
 {
+	/* The save being written may still fail */
+	v_save_poll(v, true);
+
 	if (!v->dirty)
 		goto quit;
 
@@ -101,13 +315,7 @@ static int v_nl_above(struct v_state *v)
 	if (v->cur_y > v->nrows)
 		return V_ERR;
 
-	struct v_row *row = &v->rows[v->cur_y];
-	if (!row) {
-		if (v_insert_row(v, v->cur_y, "", 0) == V_ERR)
-			return V_ERR;
-	}
-
-	if (v_insert_row(v, v->cur_y, "", 0) == V_ERR)
+	if (v_open_line(v, v->cur_y) == V_ERR)
 		return V_ERR;
 
 	v->cur_x = 0;
@@ -121,13 +329,7 @@ static int v_nl_below(struct v_state *v)
 	if (v->cur_y > v->nrows)
 		return V_ERR;
 
-	struct v_row *row = &v->rows[v->cur_y];
-	if (!row) {
-		if (v_insert_row(v, v->cur_y, "", 0) == V_ERR)
-			return V_ERR;
-	}
-
-	if (v_insert_row(v, v->cur_y + 1, "", 0) == V_ERR)
+	if (v_open_line(v, v->cur_y + 1) == V_ERR)
 		return V_ERR;
 
 	v->cur_y++;
@@ -145,7 +347,7 @@ static const struct v_key cmd_keys[] = {
 	{CTRL('h'), v_bksp},		/*   8, Left backspacing */
 	{CTRL('n'), v_cur_down},	/*  14, Next line (cursor down) */
 	{CTRL('p'), v_cur_up},		/*  16, Previous line (cursor up) */
-	{CTRL('l'), v_rfsh_scr},	/*  12, Force refresh editor window */
+	{CTRL('l'), v_redraw},		/*  12, Force redraw editor window */
 	{CTRL('q'), v_quit},		/*  17, Quit the editor */
 	{CTRL('s'), v_save},		/*  19, Save changes made */
 	{CTRL('x'), v_force_quit},	/*  24, Force quit the editor */
@@ -162,6 +364,7 @@ static const struct v_key cmd_keys[] = {
 	{'l', v_cur_right},		/* 108, Move cursor right */
 	{'o', v_nl_below},		/* 111, Add a new line below */
 	{'x', v_right_bksp},		/* 120, Right backspacing */
+	{V_KEY_PASTE, v_paste_skip},	/* 512, Bracketed paste, left out */
 	{0, NULL}			/* Sentinel */
 };
 
@@ -185,13 +388,14 @@ static int v_switch_cmd(struct v_state *v)
 
 static const struct v_key insert_keys[] = {
 	{'\b', v_bksp},			/*   8, Left backspacing */
-	{CTRL('l'), v_rfsh_scr},	/*  12, Force refresh editor window */
+	{CTRL('l'), v_redraw},		/*  12, Force redraw editor window */
 	{V_KEY_NL, v_insert_nl},	/*  10, Insert newline */
 	{V_KEY_RET, v_insert_nl},	/*  13, Insert newline */
 	{V_KEY_ESC, v_switch_cmd},	/*  27, Switch into Command Mode */
 	{V_KEY_BKSP, v_bksp},		/* 127, Left backspacing */
 	{KEY_BACKSPACE, v_bksp},	/* 263, Left backspacing */
 	{KEY_ENTER, v_insert_nl},	/* 343, Insert newline */
+	{V_KEY_PASTE, v_paste_input},	/* 512, Insert bracketed paste */
 	{0, NULL}			/* Sentinel */
 };
 
@@ -207,31 +411,127 @@ static int v_insert_input(struct v_state *v, int key)
 	return V_ERR;
 }
 
+/* === Read-only view related === */
+
+static const struct v_key view_keys[] = {
+	{CTRL('a'), v_cur_bol},		/*   1, Go to BOL */
+	{CTRL('b'), v_ppage},		/*   2, Page up */
+	{CTRL('c'), v_cur_pos},		/*   3, Show current cursor position */
+	{CTRL('e'), v_cur_eol},		/*   5, Go to EOL */
+	{CTRL('f'), v_npage},		/*   6, Page down */
+	{CTRL('n'), v_cur_down},	/*  14, Next line (cursor down) */
+	{CTRL('p'), v_cur_up},		/*  16, Previous line (cursor up) */
+	{CTRL('l'), v_redraw},		/*  12, Force redraw editor window */
+	{CTRL('q'), v_quit},		/*  17, Quit the editor */
+	{CTRL('x'), v_force_quit},	/*  24, Force quit the editor */
+	{' ', v_npage},			/*  32, Page down */
+	{'$', v_cur_eol},		/*  36, Go to EOL */
+	{'0', v_cur_bol},		/*  48, Go to BOL */
+	{'G', v_bottom_pg},		/*  71, Go to the bottom of the page */
+	{'b', v_ppage},			/*  98, Page up */
+	{'g', v_top_pg},		/* 103, Go to the top of the page */
+	{'h', v_cur_left},		/* 104, Move cursor left */
+	{'j', v_cur_down},		/* 106, Move cursor down */
+	{'k', v_cur_up},		/* 107, Move cursor up */
+	{'l', v_cur_right},		/* 108, Move cursor right */
+	{'q', v_force_quit},		/* 113, Quit the editor */
+	{KEY_LEFT, v_cur_left},		/* Arrow Left key */
+	{KEY_RIGHT, v_cur_right},	/* Arrow Right key */
+	{KEY_UP, v_cur_up},		/* Arrow Up key */
+	{KEY_DOWN, v_cur_down},		/* Arrow Down key */
+	{KEY_HOME, v_cur_bol},		/* Home key */
+	{KEY_END, v_cur_eol},		/* End key */
+	{KEY_PPAGE, v_ppage},		/* Page Up key */
+	{KEY_NPAGE, v_npage},		/* Page Down key */
+	{V_KEY_PASTE, v_paste_skip},	/* Bracketed paste, left out */
+	{0, NULL}			/* Sentinel */
+};
+
+static int v_view_input(struct v_state *v, int key)
+{
+	for (int i = 0; view_keys[i].func; i++)
+		if (view_keys[i].key == key)
+			return view_keys[i].func(v);
+
+	if (key >= 0 && key != ERR)
+		v_set_stats_msg(v, "Read-only view. Press q to quit.");
+
+	return V_ERR;
+}
+
 /* === Input related functions === */
 
+static int v_prcs_input(struct v_state *v, int key)
+{
+	if (v->view)
+		return v_view_input(v, key);
+
+	if (v_global(v, key) == V_OK)
+		return V_OK;
+
+	if (v->mode == V_CMD)
+		return v_cmd_input(v, key);
+
+	return v_insert_input(v, key);
+}
+
 /**
- * v_prcs_key - read a key and process it for the specified v_state
+ * v_prcs_keys - read a key and process it along with the keys queued after it
  * v: Pointer to the targeted v_state struct.
  *
- * Read a key and process it for the specified v_state. The input processing is
- * done according to the specified v_state current editor mode. Please take note
- * that the curses window must be initialiazed before this function call.
+ * Read a key and process it according to the specified v_state current editor
+ * mode, then keep processing the keys which were already typed after it, so
+ * that the screen is refreshed once for all of them rather than once per key.
+ * No key is ever waited for past the first one. At most v->batch keys are
+ * processed per call, and no more once V_KEY_LATENCY ms went by, so that the
+ * screen still follows along with a never ending stream of keys. The view is
+ * scrolled to the cursor after every key, for each of them to start from where
+ * the previous one left it. Prompts and confirmations read from the same
+ * queue, in the order the keys were typed. Any timeout() set for the first
+ * read is reverted, so that prompts still block. In the read-only view, only
+ * the keys which don't edit the buffer are available. The curses window must
+ * be initialized before this function call.
  *
- * Returns V_OK on success, V_ERR otherwise.
+ * Returns the outcome of the last key processed: V_OK on success, V_ERR
+ * otherwise.
  */
-int v_prcs_key(struct v_state *v)
+int v_prcs_keys(struct v_state *v)
 {
 	if (!v)
 		return V_ERR;
 
 	int key = getch();
-	if (v_global(v, key) == V_OK)
+	timeout(-1);
+	if (key == ERR)
 		return V_OK;
 
-	if (v->mode == V_CMD)
-		return v_cmd_input(v, key);
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	int ret = v_prcs_input(v, key);
 
-	return v_insert_input(v, key);
+	/* Keys like Page Down start from the view the last key left */
+	v_scroll(v);
+
+	for (int n = 1; n < v->batch && v->run; n++) {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		long ms = (now.tv_sec - start.tv_sec) * 1000 +
+			  (now.tv_nsec - start.tv_nsec) / 1000000;
+		if (ms >= V_KEY_LATENCY)
+			break;
+
+		/* Only take what is already there */
+		timeout(0);
+		key = getch();
+		timeout(-1);
+		if (key == ERR)
+			break;
+
+		ret = v_prcs_input(v, key);
+		v_scroll(v);
+	}
+
+	return ret;
 }
 
 static int get_prompt_input(char *buf, size_t *bufsz, size_t *buflen)
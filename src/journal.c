@@ -0,0 +1,551 @@
+/*
+ * journal.c - Edit journal routines
+ *
+ * This file provides the edit journal, which keeps the changes made to the
+ * buffer safe from a dying session without saving the whole file. Every edit
+ * carried out by the editor operations of editor.c, the only ones the keys
+ * reach the buffer through, appends a compact record to an in-memory buffer,
+ * which the main loop writes out to a hidden swap file next to the edited
+ * file and fsync()s every V_JRNL_SYNC milliseconds at most, so that a
+ * keystroke only costs a memcpy(). The swap file starts with the identity of
+ * the file the records apply to, and is replayed when void opens that very
+ * same file again. It is rewritten whenever the file is saved, and removed
+ * once the editor quits.
+ *
+ * The swap file is made of a v_jrnl_hdr followed by the records. A record is
+ * a V_JRNL_REC bytes long header, holding a checksum of the rest of the
+ * record, the operation, the cursor position y and x it was carried out from
+ * and a length, followed by length bytes of text. A record is replayed by
+ * carrying out the very same operation from the very same position. A record
+ * torn by a crash fails its checksum and ends the replay.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <void.h>
+
+static uint32_t v_jrnl_sum(const char *p, size_t len)
+{
+	uint32_t sum = 2166136261u;
+
+	/* FNV-1a */
+	for (size_t i = 0; i < len; i++) {
+		sum ^= (unsigned char)p[i];
+		sum *= 16777619u;
+	}
+
+	return sum;
+}
+
+static void v_jrnl_id(char *filename, struct v_jrnl_hdr *hdr)
+{
+	struct stat st;
+
+	memset(hdr, 0, sizeof(struct v_jrnl_hdr));
+	memcpy(hdr->magic, V_JRNL_MAGIC, sizeof(hdr->magic));
+	if (stat(filename, &st) == -1)
+		return;
+
+	hdr->ino = st.st_ino;
+	hdr->size = st.st_size;
+	hdr->sec = st.st_mtim.tv_sec;
+	hdr->nsec = st.st_mtim.tv_nsec;
+}
+
+static char *v_jrnl_path(char *filename)
+{
+	char *slash = strrchr(filename, '/');
+	int dir = slash ? slash - filename + 1 : 0;
+	char *base = filename + dir;
+	size_t n = strlen(filename) + sizeof("." V_JRNL_EXT);
+	char *path = malloc(n);
+	if (!path)
+		return NULL;
+
+	snprintf(path, n, "%.*s.%s%s", dir, filename, base, V_JRNL_EXT);
+
+	return path;
+}
+
+static int v_jrnl_write(int fd, char *p, size_t len)
+{
+	while (len > 0) {
+		ssize_t n = write(fd, p, len);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1)
+			return V_ERR;
+		p += n;
+		len -= n;
+	}
+
+	return V_OK;
+}
+
+/* Nothing touches the disk until the first edit */
+static int v_jrnl_create(struct v_jrnl *jr)
+{
+	if (jr->fd != -1)
+		return V_OK;
+
+	jr->fd = open(jr->path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (jr->fd == -1)
+		return V_ERR;
+	if (v_jrnl_write(jr->fd, (char *)&jr->hdr,
+			 sizeof(struct v_jrnl_hdr)) == V_ERR)
+		return V_ERR;
+	jr->off = sizeof(struct v_jrnl_hdr);
+
+	return V_OK;
+}
+
+static int v_jrnl_flush(struct v_jrnl *jr)
+{
+	if (!jr->len)
+		return V_OK;
+
+	if (v_jrnl_create(jr) == V_ERR)
+		return V_ERR;
+
+	if (v_jrnl_write(jr->fd, jr->buf, jr->len) == V_ERR)
+		return V_ERR;
+
+	jr->off += jr->len;
+	jr->len = 0;
+	jr->unsynced = true;
+
+	return V_OK;
+}
+
+static struct v_jrnl *v_jrnl_new(char *filename)
+{
+	struct v_jrnl *jr = calloc(1, sizeof(struct v_jrnl));
+	if (!jr)
+		return NULL;
+
+	jr->path = v_jrnl_path(filename);
+	if (!jr->path) {
+		free(jr);
+		return NULL;
+	}
+
+	jr->fd = -1;
+	v_jrnl_id(filename, &jr->hdr);
+	clock_gettime(CLOCK_MONOTONIC, &jr->synced);
+
+	return jr;
+}
+
+static int v_jrnl_apply(struct v_state *v, int op, int y, int x, char *s,
+			uint32_t len)
+{
+	struct v_row *row = y < v->nrows ? v_row_at(v, y) : NULL;
+	if (y > v->nrows || x > (row ? row->len : 0))
+		return V_ERR;
+
+	v->cur_y = y;
+	v->cur_x = x;
+
+	int ret = V_ERR;
+	switch (op) {
+	case V_JRNL_INSERT:
+		if (len == 1)
+			ret = v_insert(v, (unsigned char)*s);
+		break;
+	case V_JRNL_NL:
+		ret = v_insert_nl(v);
+		break;
+	case V_JRNL_BKSP:
+		ret = v_bksp(v);
+		break;
+	case V_JRNL_PASTE:
+		ret = v_paste(v, s, len);
+		break;
+	case V_JRNL_OPEN:
+		ret = v_open_line(v, y);
+		break;
+	}
+
+	return ret == V_ERR ? V_ERR : V_OK;
+}
+
+/* Returns the number of records replayed, their end inside p in *end */
+static int v_jrnl_replay(struct v_state *v, char *p, size_t size,
+			 size_t *end)
+{
+	size_t off = sizeof(struct v_jrnl_hdr);
+	int n = 0;
+
+	while (size - off >= V_JRNL_REC) {
+		char *rec = p + off;
+		uint32_t sum, y, x, len;
+		memcpy(&sum, rec, 4);
+		memcpy(&y, rec + 5, 4);
+		memcpy(&x, rec + 9, 4);
+		memcpy(&len, rec + 13, 4);
+
+		if (len > size - off - V_JRNL_REC ||
+		    v_jrnl_sum(rec + 4, V_JRNL_REC - 4 + len) != sum)
+			break;
+
+		if (y > INT32_MAX || x > INT32_MAX ||
+		    v_jrnl_apply(v, rec[4], y, x, rec + V_JRNL_REC,
+				 len) == V_ERR)
+			break;
+
+		off += V_JRNL_REC + len;
+		n++;
+	}
+
+	*end = off;
+
+	return n;
+}
+
+/**
+ * v_jrnl_open - start journaling the edits made to the opened file
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Start journaling the edits made to v->filename. When a swap file left
+ * behind by a dead session is found for the very same version of the file,
+ * the file is loaded completely and the records of the swap file are replayed
+ * onto it, then the new records are appended to them. A swap file meant for
+ * another version of the file is overwritten by the first edit. Does nothing
+ * when no file is opened.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_jrnl_open(struct v_state *v)
+{
+	if (!v)
+		return V_ERR;
+
+	if (!v->filename || v->jr)
+		return V_OK;
+
+	struct v_jrnl *jr = v_jrnl_new(v->filename);
+	if (!jr)
+		return V_ERR;
+
+	int fd = open(jr->path, O_RDWR);
+	struct stat st;
+	char *p = NULL;
+	if (fd == -1 || fstat(fd, &st) == -1 ||
+	    (size_t)st.st_size <= sizeof(struct v_jrnl_hdr))
+		goto done;
+
+	p = malloc(st.st_size);
+	if (!p || pread(fd, p, st.st_size, 0) != st.st_size ||
+	    memcmp(p, &jr->hdr, sizeof(struct v_jrnl_hdr)))
+		goto done;
+
+	/* The records apply to the whole file */
+	v_load_poll(v, true);
+
+	size_t end = 0;
+	int n = v_jrnl_replay(v, p, st.st_size, &end);
+	if (!n)
+		goto done;
+
+	/* Drop a record torn by the crash, the next ones go after it */
+	if (ftruncate(fd, end) == -1 || lseek(fd, end, SEEK_SET) == -1)
+		goto done;
+
+	jr->fd = fd;
+	jr->off = end;
+	fd = -1;
+	v->dirty = true;
+	v_set_stats_msg(v, "Recovered %d edits from %s", n, jr->path);
+
+done:
+	if (fd != -1)
+		close(fd);
+	free(p);
+	v->jr = jr;
+
+	return V_OK;
+}
+
+/**
+ * v_jrnl_add - journal an edit
+ * v: Pointer to the targeted v_state struct.
+ * op: The edit, one of the V_JRNL_* operations.
+ * y: Cursor y-position the edit was carried out from.
+ * x: Cursor x-position the edit was carried out from.
+ * s: Text of the edit, if any.
+ * len: Length of text s.
+ *
+ * Journal an edit which was just carried out on the buffer by one of the
+ * editor operations. The record is only appended to the in-memory journal
+ * buffer, which v_jrnl_sync() writes out later on. Does nothing when no
+ * journal is kept.
+ *
+ * Returns V_OK on success, V_ERR when the record couldn't be kept, in which
+ * case journaling stopped.
+ */
+int v_jrnl_add(struct v_state *v, int op, int y, int x, char *s, size_t len)
+{
+	if (!v || (!s && len))
+		return V_ERR;
+
+	struct v_jrnl *jr = v->jr;
+	if (!jr)
+		return V_OK;
+
+	if (len > UINT32_MAX) {
+		errno = EFBIG;
+		return v_jrnl_stop(v);
+	}
+
+	if (jr->len + V_JRNL_REC + len > V_JRNL_BUF &&
+	    v_jrnl_flush(jr) == V_ERR)
+		return v_jrnl_stop(v);
+
+	/* A huge record goes through a buffer of its own */
+	char *rec = jr->buf + jr->len;
+	char *big = NULL;
+	if (V_JRNL_REC + len > V_JRNL_BUF) {
+		big = malloc(V_JRNL_REC + len);
+		if (!big)
+			return v_jrnl_stop(v);
+		rec = big;
+	}
+
+	uint32_t y32 = y, x32 = x, len32 = len;
+	rec[4] = op;
+	memcpy(rec + 5, &y32, 4);
+	memcpy(rec + 9, &x32, 4);
+	memcpy(rec + 13, &len32, 4);
+	if (len)
+		memcpy(rec + V_JRNL_REC, s, len);
+
+	uint32_t sum = v_jrnl_sum(rec + 4, V_JRNL_REC - 4 + len);
+	memcpy(rec, &sum, 4);
+
+	if (!big) {
+		jr->len += V_JRNL_REC + len;
+		return V_OK;
+	}
+
+	int ret = v_jrnl_flush(jr);
+	if (ret == V_OK)
+		ret = v_jrnl_create(jr);
+	if (ret == V_OK)
+		ret = v_jrnl_write(jr->fd, big, V_JRNL_REC + len);
+	if (ret == V_OK) {
+		jr->off += V_JRNL_REC + len;
+		jr->unsynced = true;
+	}
+	free(big);
+
+	return ret == V_OK ? V_OK : v_jrnl_stop(v);
+}
+
+/**
+ * v_jrnl_sync - write the journaled edits out to the swap file
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Write the records waiting in the journal buffer out to the swap file, and
+ * fsync() it once V_JRNL_SYNC milliseconds went by since the last time,
+ * unless v->sync is V_SYNC_NONE. Meant to be called every time the editor
+ * goes around its main loop, so that the edits of a whole batch of keys are
+ * synced together. Should the swap file fail to be written, it is removed and
+ * journaling stops, rather than leaving a gap in the records.
+ *
+ * Returns true while some records were not fsync()ed yet, false otherwise.
+ */
+bool v_jrnl_sync(struct v_state *v)
+{
+	if (!v || !v->jr)
+		return false;
+
+	struct v_jrnl *jr = v->jr;
+	if (v_jrnl_flush(jr) == V_ERR) {
+		v_jrnl_stop(v);
+		return false;
+	}
+
+	if (!jr->unsynced || v->sync == V_SYNC_NONE)
+		return false;
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	long ms = (now.tv_sec - jr->synced.tv_sec) * 1000 +
+		  (now.tv_nsec - jr->synced.tv_nsec) / 1000000;
+	if (ms < V_JRNL_SYNC)
+		return true;
+
+	fdatasync(jr->fd);
+	jr->synced = now;
+	jr->unsynced = false;
+
+	return false;
+}
+
+/**
+ * v_jrnl_mark - note where the journal stands when a save starts
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Note which records were written out when a snapshot of the buffer is taken
+ * for saving. Those are the records v_jrnl_saved() drops once the save is
+ * done, the following ones being made after the snapshot. A file saved for
+ * the first time starts being journaled here, so that the edits made while it
+ * is being written are kept as well, unless it is being followed. Its swap
+ * file is only good for a replay once v_jrnl_saved() gives it the identity of
+ * the saved file.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_jrnl_mark(struct v_state *v)
+{
+	if (!v)
+		return V_ERR;
+
+	/* The lines appended to a followed file never go through it */
+	if (!v->jr && v->filename && !v->fw) {
+		v->jr = v_jrnl_new(v->filename);
+		if (!v->jr)
+			return V_ERR;
+		memset(&v->jr->hdr, 0, sizeof(struct v_jrnl_hdr));
+	}
+
+	struct v_jrnl *jr = v->jr;
+	if (!jr)
+		return V_OK;
+
+	if (v_jrnl_flush(jr) == V_ERR)
+		return v_jrnl_stop(v);
+
+	/* Records start past the header, once the swap file gets one */
+	jr->mark = jr->fd == -1 ? (off_t)sizeof(struct v_jrnl_hdr) : jr->off;
+
+	return V_OK;
+}
+
+/**
+ * v_jrnl_saved - restart the journal from a freshly saved file
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Restart the journal from the version of v->filename which was just saved.
+ * The swap file is rewritten with the identity of that version and only
+ * keeps the records made after v_jrnl_mark() was called, which the saved file
+ * doesn't hold.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_jrnl_saved(struct v_state *v)
+{
+	if (!v || !v->filename)
+		return V_ERR;
+
+	struct v_jrnl *jr = v->jr;
+	if (!jr)
+		return V_OK;
+
+	if (v_jrnl_flush(jr) == V_ERR)
+		return v_jrnl_stop(v);
+
+	v_jrnl_id(v->filename, &jr->hdr);
+	if (jr->fd == -1)
+		return V_OK;
+
+	/* Keep the records made while saving, they're not in the file */
+	size_t left = jr->off - jr->mark;
+	char *p = malloc(sizeof(struct v_jrnl_hdr) + left);
+	if (!p)
+		return v_jrnl_stop(v);
+
+	memcpy(p, &jr->hdr, sizeof(struct v_jrnl_hdr));
+	int ret = V_ERR;
+	if (pread(jr->fd, p + sizeof(struct v_jrnl_hdr), left, jr->mark) !=
+	    (ssize_t)left)
+		goto out;
+
+	jr->off = sizeof(struct v_jrnl_hdr) + left;
+	jr->mark = 0;
+	if (ftruncate(jr->fd, 0) == -1 || lseek(jr->fd, 0, SEEK_SET) == -1 ||
+	    v_jrnl_write(jr->fd, p, jr->off) == V_ERR)
+		goto out;
+
+	jr->unsynced = true;
+	ret = V_OK;
+
+out:
+	free(p);
+
+	return ret == V_OK ? V_OK : v_jrnl_stop(v);
+}
+
+/**
+ * v_jrnl_stop - stop journaling once the journal can't follow the buffer
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Stop journaling once an edit couldn't be journaled, or was left halfway
+ * done by a failure. Either way the records don't tell the whole story
+ * anymore, and a replay would apply the edits following the gap to the wrong
+ * text: the swap file is removed, and the reason is shown from errno. The
+ * next save starts a new journal from the saved file. Does nothing when no
+ * journal is kept.
+ *
+ * Returns V_ERR, for the failed edit to be returned right away.
+ */
+int v_jrnl_stop(struct v_state *v)
+{
+	if (!v || !v->jr)
+		return V_ERR;
+
+	v_set_stats_msg(v, "ERR: %s: %s, edits no longer journaled",
+			v->jr->path, strerror(errno));
+	v_jrnl_close(v);
+
+	return V_ERR;
+}
+
+/**
+ * v_jrnl_close - stop journaling and remove the swap file
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Stop journaling and remove the swap file, which is what quitting the editor
+ * does: only a session dying on its own leaves the swap file behind. Does
+ * nothing when no journal is kept.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_jrnl_close(struct v_state *v)
+{
+	if (!v)
+		return V_ERR;
+
+	struct v_jrnl *jr = v->jr;
+	if (!jr)
+		return V_OK;
+
+	if (jr->fd != -1) {
+		close(jr->fd);
+		unlink(jr->path);
+	}
+
+	free(jr->path);
+	free(jr);
+	v->jr = NULL;
+
+	return V_OK;
+}
@@ -0,0 +1,448 @@
+/*
+ * loader.c - Background file loading routines
+ *
+ * This file provides the background loader, which lets the editor show a file
+ * before it is done reading it. A loader thread reads (or scans the mapping
+ * of) the file and splits it into batches of lines, while the editor thread
+ * appends those batches to the row tree every time it goes around its main
+ * loop. The loader thread never touches the v_state struct: the text it reads
+ * goes into its own arena, which is only handed over to the editor once the
+ * thread is joined, or in piece table mode into the original buffer set
+ * aside for it beforehand. The batches are passed through a queue guarded by
+ * a mutex.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <void.h>
+
+static bool v_load_queue(struct v_loader *ld, struct v_batch *batch)
+{
+	pthread_mutex_lock(&ld->lock);
+
+	bool stop = ld->stop;
+	if (stop) {
+		free(batch);
+	} else {
+		if (ld->tail)
+			ld->tail->next = batch;
+		else
+			ld->head = batch;
+		ld->tail = batch;
+	}
+
+	pthread_cond_broadcast(&ld->cond);
+	pthread_mutex_unlock(&ld->lock);
+
+	return !stop;
+}
+
+static int v_load_add(void *arg, struct v_line *lines, int n)
+{
+	struct v_loader *ld = arg;
+
+	while (n > 0) {
+		if (!ld->fill) {
+			ld->fill = malloc(sizeof(struct v_batch));
+			if (!ld->fill)
+				return V_ERR;
+			ld->fill->next = NULL;
+			ld->fill->n = 0;
+		}
+
+		struct v_batch *batch = ld->fill;
+		int k = V_LOAD_BATCH - batch->n;
+		if (k > n)
+			k = n;
+
+		memcpy(&batch->lines[batch->n], lines, sizeof(struct v_line) * k);
+		batch->n += k;
+		lines += k;
+		n -= k;
+		if (batch->n < V_LOAD_BATCH)
+			break;
+
+		struct v_line *line = &batch->lines[batch->n - 1];
+		batch->off = ld->from_off + (line->s + line->len - ld->from);
+		ld->fill = NULL;
+		if (!v_load_queue(ld, batch))
+			return V_ERR;
+	}
+
+	return V_OK;
+}
+
+/* Returns NULL when out of memory or asked to stop */
+static char *v_load_scan(struct v_loader *ld, char *p, char *end, bool last,
+			 size_t off)
+{
+	ld->from = p;
+	ld->from_off = off - (end - p);
+
+	char *next = v_index_lines(p, end, last, ld->threads, v_load_add, ld);
+	struct v_batch *batch = ld->fill;
+	ld->fill = NULL;
+	if (!next) {
+		free(batch);
+		return NULL;
+	}
+
+	/* Don't keep the last lines of the block waiting */
+	if (batch) {
+		batch->off = off - (end - next);
+		if (!v_load_queue(ld, batch))
+			return NULL;
+	}
+
+	return next;
+}
+
+static int v_load_map(struct v_loader *ld)
+{
+	char *end = ld->map + ld->size;
+
+	/* Splitting reads the mapping once from start to end */
+	madvise(ld->map, ld->size, MADV_SEQUENTIAL);
+	char *p = v_load_scan(ld, ld->map, end, true, ld->size);
+	madvise(ld->map, ld->size, MADV_NORMAL);
+
+	return p ? 0 : ENOMEM;
+}
+
+/* Piece table mode, the file goes into a single read-only buffer */
+static int v_load_src(struct v_loader *ld)
+{
+	size_t blk = ld->threads > 1 ? (size_t)ld->threads * V_INDEX_BLK :
+		     V_READ_BLK;
+	char *p = ld->src;
+	size_t len = 0;
+
+	for (;;) {
+		size_t want = ld->size - len < blk ? ld->size - len : blk;
+		ssize_t n = read(ld->fd, ld->src + len, want);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1)
+			return errno;
+		len += n;
+
+		/* Whatever gets appended past the size it had is left out */
+		bool last = n == 0 || len == ld->size;
+		p = v_load_scan(ld, p, ld->src + len, last, len);
+		if (!p)
+			return ENOMEM;
+		if (last)
+			return 0;
+	}
+}
+
+static int v_load_read(struct v_loader *ld)
+{
+	size_t blk = ld->threads > 1 ? (size_t)ld->threads * V_INDEX_BLK :
+		     V_READ_BLK;
+	size_t cap = ld->size < blk ? ld->size + 1 : blk;
+	size_t carry = 0;
+	char *from = NULL;
+	size_t done = 0;
+
+	for (;;) {
+		struct v_blk *blk = malloc(sizeof(struct v_blk) + cap);
+		if (!blk)
+			return ENOMEM;
+
+		blk->cap = cap;
+		blk->len = carry;
+		blk->next = ld->arena;
+		ld->arena = blk;
+		if (carry)
+			memcpy(blk->data, from, carry);
+
+		ssize_t n = 0;
+		while (blk->len < blk->cap &&
+		       (n = read(ld->fd, &blk->data[blk->len],
+				 blk->cap - blk->len)) != 0) {
+			if (n == -1 && errno == EINTR)
+				continue;
+			if (n == -1)
+				return errno;
+			blk->len += n;
+			done += n;
+		}
+
+		bool last = blk->len < blk->cap;
+		char *end = blk->data + blk->len;
+		char *next = v_load_scan(ld, blk->data, end, last, done);
+		if (!next)
+			return ENOMEM;
+		if (last)
+			return 0;
+
+		/* Carry the unfinished line over, it may not even fit */
+		carry = end - next;
+		from = next;
+		if (carry == blk->len)
+			cap *= 2;
+	}
+}
+
+static void *v_load_run(void *arg)
+{
+	struct v_loader *ld = arg;
+	int err = ld->map ? v_load_map(ld) :
+		  ld->src ? v_load_src(ld) : v_load_read(ld);
+
+	pthread_mutex_lock(&ld->lock);
+	ld->err = err;
+	ld->end = true;
+	pthread_cond_broadcast(&ld->cond);
+	pthread_mutex_unlock(&ld->lock);
+
+	return NULL;
+}
+
+static void v_load_free(struct v_state *v)
+{
+	struct v_loader *ld = v->ld;
+
+	pthread_join(ld->tid, NULL);
+
+	while (ld->head) {
+		struct v_batch *next = ld->head->next;
+		free(ld->head);
+		ld->head = next;
+	}
+
+	/* Rows borrow the text read by the thread, keep it with the rest */
+	if (ld->arena) {
+		struct v_blk *last = ld->arena;
+		while (last->next)
+			last = last->next;
+		last->next = v->arena;
+		v->arena = ld->arena;
+	}
+
+	close(ld->fd);
+	pthread_mutex_destroy(&ld->lock);
+	pthread_cond_destroy(&ld->cond);
+	free(ld);
+	v->ld = NULL;
+}
+
+/**
+ * v_load_start - start loading a file in the background
+ * v: Pointer to the targeted v_state struct.
+ * filename: The name of the targeted file.
+ *
+ * Start loading a file in the background. A loader thread is started to read
+ * the file, and this function only waits for its first batch of lines so that
+ * the first screen can be drawn right away. The rest of the lines are appended
+ * by v_load_poll(). In memory mapped file mode, the file is mapped here and
+ * the thread only scans the mapping. In piece table mode, the thread reads
+ * the whole file into the read-only v->src buffer, allocated here, and the
+ * rows refer to it as the original buffer of the piece table.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_load_start(struct v_state *v, char *filename)
+{
+	if (!v || !filename || v->ld)
+		return V_ERR;
+
+	v->filename = strdup(filename);
+	if (!v->filename)
+		return V_ERR;
+
+	struct v_loader *ld = calloc(1, sizeof(struct v_loader));
+	if (!ld)
+		return V_ERR;
+
+	ld->threads = v->threads;
+	ld->fd = open(filename, O_RDONLY);
+	if (ld->fd == -1)
+		goto error;
+
+	struct stat st;
+	if (fstat(ld->fd, &st) == -1)
+		goto error;
+	ld->size = st.st_size;
+
+	if (v->mm && ld->size) {
+		ld->map = mmap(NULL, ld->size, PROT_READ, MAP_PRIVATE, ld->fd,
+			       0);
+		if (ld->map == MAP_FAILED) {
+			ld->map = NULL;
+			goto error;
+		}
+		v->src = ld->map;
+		v->src_len = ld->size;
+	} else if (v->pt && ld->size) {
+		ld->src = malloc(ld->size);
+		if (!ld->src)
+			goto error;
+		v->src = ld->src;
+		v->src_len = ld->size;
+	}
+
+	pthread_mutex_init(&ld->lock, NULL);
+	pthread_cond_init(&ld->cond, NULL);
+	if (pthread_create(&ld->tid, NULL, v_load_run, ld)) {
+		pthread_mutex_destroy(&ld->lock);
+		pthread_cond_destroy(&ld->cond);
+		goto error;
+	}
+	v->ld = ld;
+
+	pthread_mutex_lock(&ld->lock);
+	while (!ld->head && !ld->end)
+		pthread_cond_wait(&ld->cond, &ld->lock);
+	pthread_mutex_unlock(&ld->lock);
+
+	return v_load_poll(v, false);
+
+error:
+	if (ld->fd != -1)
+		close(ld->fd);
+	free(ld);
+
+	return V_ERR;
+}
+
+/**
+ * v_load_poll - append the lines loaded in the background so far
+ * v: Pointer to the targeted v_state struct.
+ * wait: Whether to wait for the whole file to be loaded.
+ *
+ * Append the batches of lines queued by the loader thread to the end of the
+ * row tree, leaving the editor dirty flag as it was. At most V_LOAD_SLICE
+ * batches are appended per call so that the editor stays responsive, and
+ * ld->backlog tells whether more of them are already waiting. When wait is
+ * true, this function keeps going until the last line of the file is
+ * appended instead. The thread is joined once it is done. While the file is
+ * still being loaded, the cursor is kept off the empty line past the end of
+ * the loaded rows, since the rest of the file is yet to be appended there.
+ * Does nothing when no file is being loaded.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_load_poll(struct v_state *v, bool wait)
+{
+	if (!v)
+		return V_ERR;
+
+	struct v_loader *ld = v->ld;
+	if (!ld)
+		return V_OK;
+
+	bool dirty = v->dirty;
+	bool end = false;
+	int left = V_LOAD_SLICE;
+	int ret = V_OK;
+
+	for (;;) {
+		pthread_mutex_lock(&ld->lock);
+		while (wait && !ld->head && !ld->end)
+			pthread_cond_wait(&ld->cond, &ld->lock);
+
+		struct v_batch *batch = ld->head;
+		if (batch)
+			ld->head = batch->next;
+		if (!ld->head)
+			ld->tail = NULL;
+		end = ld->end && !ld->head;
+		ld->backlog = ld->head != NULL;
+		pthread_mutex_unlock(&ld->lock);
+
+		if (!batch)
+			break;
+
+		if (v_append_rows_ref(v, batch->lines, batch->n) == V_ERR)
+			ret = V_ERR;
+		ld->added = batch->off;
+		free(batch);
+
+		/* Leave the rest for later and let the editor breathe */
+		if (!wait && --left == 0)
+			break;
+	}
+
+	v->dirty = dirty;
+
+	if (end) {
+		if (ld->err) {
+			v_set_stats_msg(v, "ERR: %s", strerror(ld->err));
+			ret = V_ERR;
+		}
+		v_load_free(v);
+		return ret;
+	}
+
+	if (v->nrows && v->cur_y >= v->nrows) {
+		v->cur_y = v->nrows - 1;
+		v->cur_x = 0;
+	}
+
+	return ret;
+}
+
+/**
+ * v_load_progress - get the progress of the background loading
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Get the progress of the background loading, as the share of the file whose
+ * lines were appended to the row tree.
+ *
+ * Returns the progress in percent, V_ERR if no file is being loaded.
+ */
+int v_load_progress(struct v_state *v)
+{
+	if (!v || !v->ld)
+		return V_ERR;
+
+	struct v_loader *ld = v->ld;
+	if (!ld->size)
+		return 100;
+
+	return ld->added * 100 / ld->size;
+}
+
+/**
+ * v_load_stop - stop loading a file in the background
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Stop loading a file in the background. The loader thread is asked to stop
+ * and joined, and the lines it queued but which weren't appended yet are
+ * dropped. Does nothing when no file is being loaded.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_load_stop(struct v_state *v)
+{
+	if (!v)
+		return V_ERR;
+
+	if (!v->ld)
+		return V_OK;
+
+	pthread_mutex_lock(&v->ld->lock);
+	v->ld->stop = true;
+	pthread_mutex_unlock(&v->ld->lock);
+
+	v_load_free(v);
+
+	return V_OK;
+}
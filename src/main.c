@@ -21,6 +21,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <ncurses.h>
 
 #include <void.h>
 
@@ -33,6 +34,22 @@ static void usage(void)
 	fputs("   -h\tDisplay this help and exit.\n", stdout);
 	fputs("   -v\tOutput version information and exit.\n", stdout);
 	fputs("   -n\tTurns off colors support.\n", stdout);
+	fputs("   -r\tView the file read-only, within a memory budget.\n",
+	      stdout);
+	fputs("   -b n\tMemory budget of the read-only view, in MiB.\n",
+	      stdout);
+	fputs("   -f\tFollow the file as it grows, like tail -f.\n", stdout);
+	fputs("   -p\tUse the piece table buffer backend.\n", stdout);
+	fputs("   -m\tMap the file into memory instead of reading it.\n",
+	      stdout);
+	fputs("   -j n\tIndex the lines of the file with n threads.\n",
+	      stdout);
+	fputs("   -s p\tfsync() policy when saving: none, file or full.\n",
+	      stdout);
+	fputs("   -k n\tApply up to n typed keys before redrawing.\n",
+	      stdout);
+	fputs("   -t\tDraw with raw escape sequences instead of curses.\n",
+	      stdout);
 
 	exit(EXIT_FAILURE);
 }
@@ -47,7 +64,7 @@ int main(int argc, char **argv)
 {
 	int opt;
 	struct v_state *v = v_new_state();
-	while ((opt = getopt(argc, argv, "hvn")) != -1) {
+	while ((opt = getopt(argc, argv, "hvnrb:fpmj:s:k:t")) != -1) {
 		switch (opt) {
 		case 'h':
 			v_dstr_state(v);
@@ -61,6 +78,63 @@ int main(int argc, char **argv)
 			/* Open without colors support */
 			v->colors = false;
 			break;
+		case 'r':
+			/* Page through files too big to be loaded */
+			v->view = true;
+			break;
+		case 'b':
+			/* Bound the memory used by the read-only view */
+			if (atoi(optarg) < 1) {
+				v_dstr_state(v);
+				usage();
+			}
+			v->budget = (size_t)atoi(optarg) << 20;
+			break;
+		case 'f':
+			/* Keep appending what gets written to the file */
+			v->follow = true;
+			break;
+		case 'p':
+			/* Keep the file read-only and edit through pieces */
+			v->pt = true;
+			break;
+		case 'm':
+			/* Rows refer to the mapped file until edited */
+			v->mm = true;
+			break;
+		case 'j':
+			/* Split the file on n cores when indexing it */
+			v->threads = atoi(optarg);
+			if (v->threads < 1 || v->threads > V_THREADS_MAX) {
+				v_dstr_state(v);
+				usage();
+			}
+			break;
+		case 's':
+			/* Trade crash safety for speed on slow disks */
+			if (!strcmp(optarg, "none")) {
+				v->sync = V_SYNC_NONE;
+			} else if (!strcmp(optarg, "file")) {
+				v->sync = V_SYNC_FILE;
+			} else if (!strcmp(optarg, "full")) {
+				v->sync = V_SYNC_FULL;
+			} else {
+				v_dstr_state(v);
+				usage();
+			}
+			break;
+		case 'k':
+			/* Catch up with fast typing in fewer redraws */
+			v->batch = atoi(optarg);
+			if (v->batch < 1) {
+				v_dstr_state(v);
+				usage();
+			}
+			break;
+		case 't':
+			/* Send each frame as a minimal diff in one write() */
+			v->vt = true;
+			break;
 		default:
 			/* Display help and exit */
 			v_dstr_state(v);
@@ -68,16 +142,42 @@ int main(int argc, char **argv)
 		}
 	}
 
+	/* Text coming down a pipe is followed, keys come from the terminal */
+	if (optind >= argc && !isatty(STDIN_FILENO))
+		v_follow_start(v, NULL);
+
 	v_init_term(v);
 	if (v->colors)
 		v_init_colors(v);
 
-	if (optind < argc)
-		v_open(v, argv[optind]);
+	if (optind < argc && v->view) {
+		v_page_open(v, argv[optind]);
+	} else if (optind < argc && v->follow) {
+		v_follow_start(v, argv[optind]);
+	} else if (optind < argc) {
+		v_load_start(v, argv[optind]);
+		v_jrnl_open(v);
+	}
 
 	while (v->run) {
-		v_rfsh_scr(v);
-		v_prcs_key(v);
+		v_load_poll(v, false);
+		v_page_poll(v, false);
+		v_save_poll(v, false);
+		bool redraw = v_follow_poll(v);
+		bool unsynced = v_jrnl_sync(v);
+		if (redraw)
+			v_rfsh_scr(v);
+
+		/* Come back for the next lines, the saving outcome or a sync */
+		if (v->ld || v->sv)
+			timeout(v->ld && v->ld->backlog ? 0 : V_LOAD_POLL);
+		else if (v->pg && !v->pg->done)
+			timeout(0);
+		else if (v->fw)
+			timeout(v_follow_wait(v));
+		else if (unsynced)
+			timeout(V_JRNL_SYNC);
+		v_prcs_keys(v);
 	}
 
 	v_dstr_state(v);
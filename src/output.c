@@ -4,7 +4,8 @@
  * This file contains routines responsible for the editor’s screen output and
  * rendering, including the stupid one line welcome message, screen refresh
  * logic, status bar, message bar, scrolling, and cursor positioning. These
- * routines rely heavily on ncurses.
+ * routines rely heavily on ncurses, unless the raw escape sequence screen found
+ * in src/screen.c is drawn on instead.
  *
  * Parts of this file are based on the kilo text editor by Salvatore Sanfilippo
  * and Paige Ruten (snaptoken)'s Build Your Own Text Editor booklet:
@@ -19,24 +20,65 @@
  */
 
 #include <ncurses.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 
 #include <void.h>
 
+static void v_out_move(struct v_state *v, int y, int x)
+{
+	if (v->scr)
+		v_scr_move(v->scr, y, x);
+	else
+		move(y, x);
+}
+
+static void v_out_str(struct v_state *v, const char *s, int len)
+{
+	if (v->scr)
+		v_scr_put(v->scr, s, len);
+	else
+		addnstr(s, len);
+}
+
+static void v_out_clrtoeol(struct v_state *v)
+{
+	if (v->scr)
+		v_scr_clrtoeol(v->scr);
+	else
+		clrtoeol();
+}
+
+static void v_out_bar(struct v_state *v, bool on)
+{
+	if (!v->colors)
+		return;
+
+	if (v->scr)
+		v_scr_attr(v->scr, on ? V_SCR_BAR : V_SCR_NORMAL);
+	else if (on)
+		attron(COLOR_PAIR(V_BAR));
+	else
+		attroff(A_BOLD | COLOR_PAIR(V_BAR));
+}
+
 static void v_draw_y(struct v_state *v, int y)
 {
 	int filerow = v->rowoff + y;
 	if (filerow < v->nrows) {
 		/* There is a row to be displayed */
-		struct v_row *row = &v->rows[filerow];
+		struct v_row *row = v_row_at(v, filerow);
+		if (row->stale != V_ROW_FRESH && v_render_row(v, row) == V_ERR)
+			return;
+
 		int len = row->rlen - v->coloff;
 		if (len < 0)
 			len = 0;
 		if (len > v->scr_x)
 			len = v->scr_x;
 
-		addnstr(&row->ren[v->coloff], len);
+		v_out_str(v, &row->ren[v->coloff], len);
 
 		return;
 	}
@@ -59,29 +101,42 @@ static void v_draw_y(struct v_state *v, int y)
 
 		int padding = (v->scr_x - len) / 2;
 		if (padding) {
-			printw("~");
+			v_out_str(v, "~", 1);
 			padding--;
 		}
 
 		while (padding--)
-			printw(" ");
+			v_out_str(v, " ", 1);
 
-		addnstr(msg, len);
+		v_out_str(v, msg, len);
 
 		return;
 	}
 
 tildes:
-	printw("~\n");
+	v_out_str(v, "~", 1);
 }
 
 static int v_draw_bar(struct v_state *v)
 {
-	move(v->scr_y, 0);
 	char left[V_STATS_LEFT_MAX], right[V_STATS_RIGHT_MAX];
-	int left_len = snprintf(left, sizeof(left), "%.20s %s",
+	char load[V_STATS_RIGHT_MAX] = "";
+	if (v->ld)
+		snprintf(load, sizeof(load), " [Loading %d%%]",
+			 v_load_progress(v));
+	else if (v->sv)
+		snprintf(load, sizeof(load), " [Saving]");
+	else if (v->pg && !v->pg->done)
+		snprintf(load, sizeof(load), " [View %d%%]",
+			 v_page_progress(v));
+	else if (v->view)
+		snprintf(load, sizeof(load), " [View]");
+	else if (v->fw && !v->fw->eof)
+		snprintf(load, sizeof(load), " [Following]");
+
+	int left_len = snprintf(left, sizeof(left), "%.20s %s%s",
 			       v->filename ? v->filename : "[No Name]",
-			       v->dirty ? "[+]" : "");
+			       v->dirty ? "[+]" : "", load);
 
 	int right_len = snprintf(right, sizeof(right), "%d,%d   ",
 				v->cur_y + 1,
@@ -90,49 +145,56 @@ static int v_draw_bar(struct v_state *v)
 	if (left_len < 0 || right_len < 0)
 		return V_ERR;
 
+	/* Leave the bar alone unless it reads differently */
+	struct v_damage *dmg = &v->dmg;
+	if (!dmg->all && !strcmp(left, dmg->left) && !strcmp(right, dmg->right))
+		return V_OK;
+	memcpy(dmg->left, left, sizeof(left));
+	memcpy(dmg->right, right, sizeof(right));
+
 	if (left_len + right_len > v->scr_x) {
 		left_len = v->scr_x - right_len;
 		if (left_len < 0)
 			left_len = 0;
 	}
 
-	if (v->colors)
-		attron(COLOR_PAIR(V_BAR));
+	v_out_move(v, v->scr_y, 0);
+	v_out_bar(v, true);
 
-	addnstr(left, left_len);
+	v_out_str(v, left, left_len);
 	for (int i = left_len; i < v->scr_x - right_len; i++)
-		printw(" ");
-
-	addnstr(right, right_len);
+		v_out_str(v, " ", 1);
 
-	if (v->colors)
-		attroff(A_BOLD | COLOR_PAIR(V_BAR));
-
-	printw("\n");
+	v_out_str(v, right, right_len);
+	v_out_bar(v, false);
 
 	return V_OK;
 }
 
-static int v_render_cur_x(struct v_row *row, int cur_x)
+/**
+ * v_scroll - scroll the view to the cursor
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Scroll the view for the cursor to be on screen, updating the row and column
+ * offsets along with the rendered cursor x-position. The screen itself is
+ * left alone: v_rfsh_scr() finds out how far the view moved since the last
+ * frame and redraws what it has to. This lets keys which depend on the view,
+ * like Page Down, be processed one after the other before a refresh. Does
+ * nothing until the screen size is known.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_scroll(struct v_state *v)
 {
-	if (!row || !row->orig || cur_x < 0)
+	if (!v)
 		return V_ERR;
 
-	int x_pos = 0;
-	for (int i = 0; i < cur_x; i++) {
-		if (row->orig[i] == '\t')
-			x_pos += (V_TABSTP - 1) - (x_pos % V_TABSTP);
-		x_pos++;
-	}
-
-	return x_pos;
-}
+	if (v->scr_y <= 0 || v->scr_x <= 0)
+		return V_OK;
 
-static void v_scroll(struct v_state *v)
-{
 	v->rcur_x = 0;
 	if (v->cur_y < v->nrows)
-		v->rcur_x = v_render_cur_x(&v->rows[v->cur_y], v->cur_x);
+		v->rcur_x = v_row_cx_to_rx(v_row_at(v, v->cur_y), v->cur_x);
 
 	if (v->cur_y < v->rowoff)
 		v->rowoff = v->cur_y;
@@ -145,6 +207,8 @@ static void v_scroll(struct v_state *v)
 
 	if (v->rcur_x >= v->coloff + v->scr_x)
 		v->coloff = v->rcur_x - v->scr_x + 1;
+
+	return V_OK;
 }
 
 /**
@@ -177,14 +241,142 @@ int v_set_stats_msg(struct v_state *v, const char *fmt, ...)
 
 static void v_draw_msg_bar(struct v_state *v)
 {
-	move(v->scr_y + 1, 0);
-	clrtoeol();
+	struct v_damage *dmg = &v->dmg;
+	if (!dmg->all && !strcmp(v->stats_msg, dmg->msg))
+		return;
+	memcpy(dmg->msg, v->stats_msg, sizeof(dmg->msg));
+
+	v_out_move(v, v->scr_y + 1, 0);
+	v_out_clrtoeol(v);
 
-	int msg_len =  strlen(v->stats_msg);
+	int msg_len = strlen(v->stats_msg);
 	if (msg_len > v->scr_x)
 		msg_len = v->scr_x;
 	if (msg_len)
-		addnstr(v->stats_msg, msg_len);
+		v_out_str(v, v->stats_msg, msg_len);
+}
+
+/**
+ * v_damage - flag the screen lines showing some rows for redrawing
+ * v: Pointer to the targeted v_state struct.
+ * y: The line number of the first row.
+ * n: Number of rows, or -1 for every row from line y onward.
+ *
+ * Flag the screen lines showing the rows from line y onward for redrawing by
+ * the next v_rfsh_scr() call. This is needed whenever rows are inserted,
+ * deleted or appended, since the rows below them are shifted. Changes made to
+ * the text of a row don't need it: the row is known to be stale until it gets
+ * rendered again.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_damage(struct v_state *v, int y, int n)
+{
+	if (!v)
+		return V_ERR;
+
+	struct v_damage *dmg = &v->dmg;
+	int from = y - dmg->rowoff;
+	int to = n < 0 ? dmg->n : from + n;
+	if (from < 0)
+		from = 0;
+	if (to > dmg->n)
+		to = dmg->n;
+
+	for (int i = from; i < to; i++)
+		dmg->lines[i] = true;
+
+	return V_OK;
+}
+
+/**
+ * v_redraw - redraw the whole editor screen
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Redraw the whole editor screen from scratch, for the terminal to be brought
+ * back in line with the editor whatever happened to it in between.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_redraw(struct v_state *v)
+{
+	if (!v)
+		return V_ERR;
+
+	v->dmg.all = true;
+	if (v->scr)
+		v_scr_invalidate(v->scr);
+	else
+		clearok(curscr, TRUE);
+
+	return v_rfsh_scr(v);
+}
+
+/* Scroll the text lines by n, the bars staying where they are */
+static void v_damage_scroll(struct v_state *v, int n)
+{
+	struct v_damage *dmg = &v->dmg;
+	int keep = dmg->n - abs(n);
+
+	if (v->scr) {
+		v_scr_scroll(v->scr, 0, v->scr_y - 1, n);
+	} else {
+		scrollok(stdscr, TRUE);
+		setscrreg(0, v->scr_y - 1);
+		scrl(n);
+		setscrreg(0, v->scr_y + 1);
+		scrollok(stdscr, FALSE);
+	}
+
+	/* Lines keep their damage along, the exposed ones are blank */
+	if (n > 0) {
+		memmove(dmg->lines, dmg->lines + n, sizeof(bool) * keep);
+		memset(dmg->lines + keep, true, sizeof(bool) * n);
+	} else {
+		memmove(dmg->lines - n, dmg->lines, sizeof(bool) * keep);
+		memset(dmg->lines, true, sizeof(bool) * -n);
+	}
+}
+
+static void v_damage_check(struct v_state *v)
+{
+	struct v_damage *dmg = &v->dmg;
+
+	if (dmg->n != v->scr_y) {
+		bool *tmp = realloc(dmg->lines, sizeof(bool) * v->scr_y);
+		if (tmp || !v->scr_y) {
+			dmg->lines = tmp;
+			dmg->n = v->scr_y;
+		}
+		dmg->all = true;
+	}
+
+	if (dmg->cols != v->scr_x || dmg->coloff != v->coloff)
+		dmg->all = true;
+
+	/*
+	 * A view moved by less than a screen still shows most of its lines,
+	 * only elsewhere: the terminal gets them scrolled instead of drawn.
+	 */
+	int n = v->rowoff - dmg->rowoff;
+	if (dmg->all || !n)
+		return;
+	if (abs(n) < dmg->n)
+		v_damage_scroll(v, n);
+	else
+		dmg->all = true;
+}
+
+static bool v_damaged(struct v_state *v, int y)
+{
+	struct v_damage *dmg = &v->dmg;
+	if (dmg->all || y >= dmg->n || dmg->lines[y])
+		return true;
+
+	/* An edited row stays stale until it gets drawn again */
+	struct v_row *row = v_row_at(v, v->rowoff + y);
+
+	return row && row->stale != V_ROW_FRESH;
 }
 
 /**
@@ -193,7 +385,13 @@ static void v_draw_msg_bar(struct v_state *v)
  *
  * Refresh the editor screen using the specified v_state. Please take note that
  * this function only works in curses mode and also responsive to SIGWINCH
- * signal.
+ * signal. Only the damaged lines are drawn again: the ones flagged by
+ * v_damage(), the ones showing an edited row, the ones the view scrolled into
+ * sight, and every line once the screen got resized. The status and message
+ * bars are only drawn again when they read differently, so that when the
+ * cursor merely moved, nothing but the cursor position is sent to the
+ * terminal. When v->scr is set, the lines are drawn on the raw escape sequence
+ * screen instead, which sends the whole frame at once.
  *
  * Returns V_OK on success, V_ERR otherwise.
  */
@@ -202,30 +400,63 @@ int v_rfsh_scr(struct v_state *v)
 	if (!v)
 		return V_ERR;
 
+	struct v_damage *dmg = &v->dmg;
 	if (v_winch) {
 		endwin();
 		refresh();
-		clear();
+		if (v->scr)
+			v_scr_invalidate(v->scr);
+		else
+			clear();
 		v_winch = 0;
+		dmg->all = true;
 	}
 
 	getmaxyx(stdscr, v->scr_y, v->scr_x);
 	v->scr_y -= 2;
 
+	struct v_screen *scr = v->scr;
+	if (scr && (scr->rows != v->scr_y + 2 || scr->cols != v->scr_x)) {
+		if (v_scr_resize(scr, v->scr_y + 2, v->scr_x) == V_ERR)
+			return V_ERR;
+		dmg->all = true;
+	}
+
 	v_scroll(v);
-	curs_set(0);
+	v_damage_check(v);
 
+	bool hidden = false;
 	for (int y = 0; y < v->scr_y; y++) {
-		move(y, 0);
+		if (!v_damaged(v, y))
+			continue;
+
+		/* Keep the cursor from running along the lines being drawn */
+		if (!hidden && !scr)
+			curs_set(0);
+		hidden = true;
+
+		v_out_move(v, y, 0);
 		v_draw_y(v, y);
-		clrtoeol();
+		v_out_clrtoeol(v);
 	}
 
 	v_draw_bar(v);
 	v_draw_msg_bar(v);
-	move(v->cur_y - v->rowoff, v->rcur_x - v->coloff);
-	refresh();
-	curs_set(1);
+	if (scr) {
+		v_scr_flush(scr, v->cur_y - v->rowoff, v->rcur_x - v->coloff);
+	} else {
+		move(v->cur_y - v->rowoff, v->rcur_x - v->coloff);
+		refresh();
+		if (hidden)
+			curs_set(1);
+	}
+
+	if (dmg->n)
+		memset(dmg->lines, 0, sizeof(bool) * dmg->n);
+	dmg->all = false;
+	dmg->rowoff = v->rowoff;
+	dmg->coloff = v->coloff;
+	dmg->cols = v->scr_x;
 
 	return V_OK;
 }
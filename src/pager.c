@@ -0,0 +1,393 @@
+/*
+ * pager.c - Read-only view routines
+ *
+ * This file provides the read-only view, which lets the editor page through
+ * files far bigger than the memory it may use. Instead of loading every line
+ * into the row tree, the file is indexed a slice at a time as the editor goes
+ * around its main loop, and only the offset of one line out of every so many
+ * is kept as a checkpoint. The rows being looked at are decoded into a small
+ * window around them by reading the file again from the closest checkpoint.
+ * The checkpoints, the indexing buffer and the window text each get a share
+ * of the memory budget, and the checkpoints are thinned out whenever their
+ * share runs out, so the memory used doesn't depend on the file size.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <void.h>
+
+static ssize_t v_page_read(int fd, char *buf, size_t len, off_t off)
+{
+	ssize_t n = 0;
+
+	while ((n = pread(fd, buf, len, off)) == -1 && errno == EINTR)
+		;
+
+	return n;
+}
+
+static int v_page_mark(struct v_pager *pg, off_t off)
+{
+	if (pg->nlines % pg->every == 0) {
+		if (pg->nckpt == pg->ckmax) {
+			/* Out of budget, keep every other checkpoint */
+			for (int i = 0; i < pg->nckpt; i += 2)
+				pg->ckpt[i / 2] = pg->ckpt[i];
+			pg->nckpt = (pg->nckpt + 1) / 2;
+			pg->every *= 2;
+		}
+
+		if (pg->nlines % pg->every == 0)
+			pg->ckpt[pg->nckpt++] = off;
+	}
+
+	pg->nlines++;
+
+	/* Leave room for a last line without line terminator */
+	return pg->nlines == INT_MAX - 1 ? V_ERR : V_OK;
+}
+
+static int v_page_index(struct v_pager *pg)
+{
+	struct v_line *lines = pg->found;
+	ssize_t len = v_page_read(pg->fd, pg->buf, pg->bcap, pg->scan);
+	if (len == -1) {
+		pg->err = errno;
+		pg->done = true;
+		return V_ERR;
+	}
+
+	if (len == 0) {
+		pg->done = true;
+		return V_OK;
+	}
+
+	char *p = pg->buf;
+	char *end = pg->buf + len;
+	int n = 0;
+
+	do {
+		char *next = v_scan_lines(p, end, false, lines, V_PAGE_SCAN,
+					  &n);
+		for (int i = 0; i < n; i++) {
+			/* Only the first line may start in an earlier slice */
+			off_t off = lines[i].s == pg->buf ? pg->line :
+				    pg->scan + (lines[i].s - pg->buf);
+			if (v_page_mark(pg, off) == V_ERR) {
+				pg->err = EFBIG;
+				pg->done = true;
+				return V_ERR;
+			}
+		}
+		if (n)
+			pg->line = pg->scan + (next - pg->buf);
+		p = next;
+	} while (n == V_PAGE_SCAN);
+
+	pg->scan += len;
+
+	return V_OK;
+}
+
+/* Returns the offset of line y inside the file, -1 if it can't be found */
+static off_t v_page_seek(struct v_pager *pg, int y)
+{
+	int c = y / pg->every;
+	if (c >= pg->nckpt)
+		c = pg->nckpt - 1;
+
+	/* No checkpoint yet means no '\n' either, line 0 starts the file */
+	off_t off = c < 0 ? 0 : pg->ckpt[c];
+	int k = c < 0 ? 0 : c * pg->every;
+
+	while (k < y) {
+		ssize_t len = v_page_read(pg->fd, pg->buf, pg->bcap, off);
+		if (len <= 0)
+			return -1;
+
+		char *p = pg->buf;
+		char *end = pg->buf + len;
+		char *nl = NULL;
+		while (k < y && (nl = memchr(p, '\n', end - p))) {
+			p = nl + 1;
+			k++;
+		}
+
+		/* Past the last '\n' of the block, the line goes on */
+		off += k == y ? p - pg->buf : len;
+	}
+
+	return off;
+}
+
+static void v_page_drop(struct v_pager *pg)
+{
+	for (int i = 0; i < pg->n; i++) {
+		struct v_row *row = &pg->rows[i];
+		if (row->rcap)
+			free(row->ren);
+		free(row->tabs);
+	}
+
+	memset(pg->rows, 0, sizeof(pg->rows));
+	pg->n = 0;
+}
+
+static int v_page_fill(struct v_pager *pg, int y)
+{
+	struct v_line *lines = pg->wlines;
+
+	v_page_drop(pg);
+	pg->base = y;
+
+	off_t off = v_page_seek(pg, y);
+	if (off == -1)
+		return V_ERR;
+
+	char *p = pg->text;
+	size_t len = 0;
+	bool eof = false;
+
+	while (pg->n < V_PAGE_WIN && !eof && len < pg->tcap) {
+		size_t want = pg->tcap - len;
+		if (want > V_READ_BLK)
+			want = V_READ_BLK;
+
+		ssize_t got = v_page_read(pg->fd, pg->text + len, want,
+					  off + len);
+		if (got == -1)
+			return V_ERR;
+		eof = (size_t)got < want;
+		len += got;
+
+		int n = 0;
+		p = v_scan_lines(p, pg->text + len, eof, lines,
+				 V_PAGE_WIN - pg->n, &n);
+		for (int i = 0; i < n; i++) {
+			struct v_row *row = &pg->rows[pg->n++];
+			row->orig = lines[i].s;
+			row->len = lines[i].len > INT_MAX ? INT_MAX :
+				   lines[i].len;
+			row->gap = row->len;
+		}
+	}
+
+	/* Cut a line longer than the whole window text short */
+	if (!pg->n && len == pg->tcap) {
+		pg->rows[0].orig = pg->text;
+		pg->rows[0].len = len > INT_MAX ? INT_MAX : len;
+		pg->rows[0].gap = pg->rows[0].len;
+		pg->n = 1;
+	}
+
+	return V_OK;
+}
+
+/**
+ * v_page_open - open a file in the read-only view
+ * v: Pointer to the targeted v_state struct.
+ * filename: The name of the targeted file.
+ *
+ * Open a file in the read-only view, within the v->budget memory budget. The
+ * line index stored by an earlier run is reused when it still applies, then
+ * the next slice of the file is indexed right away so that the first screen
+ * can be drawn. The rest of it is left to v_page_poll(). The rows of the file
+ * are then looked up through v_page_row() instead of the row tree.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_page_open(struct v_state *v, char *filename)
+{
+	if (!v || !filename || v->pg)
+		return V_ERR;
+
+	v->filename = strdup(filename);
+	if (!v->filename)
+		return V_ERR;
+
+	struct v_pager *pg = calloc(1, sizeof(struct v_pager));
+	if (!pg)
+		return V_ERR;
+
+	pg->fd = open(filename, O_RDONLY);
+	if (pg->fd == -1)
+		goto error;
+
+	struct stat st;
+	if (fstat(pg->fd, &st) == -1)
+		goto error;
+	pg->size = st.st_size;
+
+	/*
+	 * A quarter to index with, another for checkpoints, half to view. The
+	 * lines scanned and the window rows come out of their own share.
+	 */
+	size_t index = v->budget / 4 - sizeof(pg->found);
+	pg->bcap = index < V_INDEX_BLK ? index : V_INDEX_BLK;
+	pg->ckmax = v->budget / 4 / sizeof(off_t);
+	pg->tcap = v->budget / 2 - sizeof(pg->rows) - sizeof(pg->wlines);
+	pg->every = V_PAGE_EVERY;
+	pg->buf = malloc(pg->bcap);
+	pg->ckpt = malloc(sizeof(off_t) * pg->ckmax);
+	pg->text = malloc(pg->tcap);
+	if (!pg->buf || !pg->ckpt || !pg->text)
+		goto error;
+
+	/* Pick up where the last run left the index */
+	v->pg = pg;
+	v_cache_load(v);
+	v_page_poll(v, false);
+
+	return V_OK;
+
+error:
+	if (pg->fd != -1)
+		close(pg->fd);
+	free(pg->buf);
+	free(pg->ckpt);
+	free(pg->text);
+	free(pg);
+
+	return V_ERR;
+}
+
+/**
+ * v_page_poll - index the next slice of the file in the read-only view
+ * v: Pointer to the targeted v_state struct.
+ * wait: Whether to index the whole rest of the file.
+ *
+ * Index the next slice of the file opened in the read-only view, so that the
+ * editor stays responsive while a huge file is being indexed. When wait is
+ * true, this function keeps going until the end of the file instead. The
+ * number of rows is updated with the lines found so far. Does nothing when
+ * the file is done being indexed, or when no file is viewed.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_page_poll(struct v_state *v, bool wait)
+{
+	if (!v)
+		return V_ERR;
+
+	struct v_pager *pg = v->pg;
+	if (!pg)
+		return V_OK;
+
+	int ret = V_OK;
+	do {
+		if (!pg->done && v_page_index(pg) == V_ERR) {
+			v_set_stats_msg(v, "ERR: %s", strerror(pg->err));
+			ret = V_ERR;
+		}
+	} while (wait && !pg->done);
+
+	/* The last line may have no line terminator */
+	int nrows = pg->nlines + (pg->done && pg->scan > pg->line);
+	if (nrows != v->nrows)
+		v_damage(v, v->nrows, -1);
+	v->nrows = nrows;
+
+	return ret;
+}
+
+/**
+ * v_page_progress - get the progress of the read-only view indexing
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Get the progress of the indexing of the file opened in the read-only view,
+ * as the share of the file indexed so far.
+ *
+ * Returns the progress in percent, V_ERR if no file is viewed.
+ */
+int v_page_progress(struct v_state *v)
+{
+	if (!v || !v->pg)
+		return V_ERR;
+
+	struct v_pager *pg = v->pg;
+	if (pg->done || !pg->size)
+		return 100;
+
+	int pct = pg->scan * 100 / pg->size;
+
+	return pct > 99 ? 99 : pct;
+}
+
+/**
+ * v_page_row - look up a row of the file opened in the read-only view
+ * v: Pointer to the targeted v_state struct.
+ * y: The line number of the row.
+ *
+ * Look up a row of the file opened in the read-only view. Rows are decoded
+ * from the file into a window of V_PAGE_WIN rows, which is moved to start a
+ * little before line y whenever line y is not inside it. The returned row
+ * only stays valid until the next lookup, and must not be edited.
+ *
+ * Returns a pointer to the v_row struct on success, NULL if there is no line y.
+ */
+struct v_row *v_page_row(struct v_state *v, int y)
+{
+	if (!v || !v->pg || y < 0 || y >= v->nrows)
+		return NULL;
+
+	struct v_pager *pg = v->pg;
+	if (y >= pg->base && y < pg->base + pg->n)
+		return &pg->rows[y - pg->base];
+
+	/* Leave room to scroll back up, a page is known to fit from y on */
+	int from = y - V_PAGE_WIN / 4;
+	if (from < 0)
+		from = 0;
+	if (v_page_fill(pg, from) == V_ERR || y >= pg->base + pg->n) {
+		if (from == y || v_page_fill(pg, y) == V_ERR || !pg->n)
+			return NULL;
+	}
+
+	return &pg->rows[y - pg->base];
+}
+
+/**
+ * v_page_close - close the file opened in the read-only view
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Close the file opened in the read-only view and release the index and the
+ * window along with it. The index is stored for the next run beforehand. Does
+ * nothing when no file is viewed.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_page_close(struct v_state *v)
+{
+	if (!v)
+		return V_ERR;
+
+	struct v_pager *pg = v->pg;
+	if (!pg)
+		return V_OK;
+
+	v_cache_store(v);
+	v_page_drop(pg);
+	close(pg->fd);
+	free(pg->buf);
+	free(pg->ckpt);
+	free(pg->text);
+	free(pg);
+	v->pg = NULL;
+	v->nrows = 0;
+
+	return V_OK;
+}
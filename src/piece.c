@@ -0,0 +1,309 @@
+/*
+ * piece.c - Piece table buffer routines
+ *
+ * This file provides the piece table buffer backend. In this mode, the
+ * original file content is loaded once into v->src and never written to
+ * again, while every inserted byte goes into an append-only add buffer made
+ * of fixed v_blk blocks. A row is then either a single borrowed run of text
+ * or an array of pieces pointing into those two buffers. Since neither buffer
+ * ever moves or changes, pieces can be freely shared between rows, so joining
+ * and splitting lines does not copy any text at all.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <void.h>
+
+static int v_pt_pieces(struct v_row *row)
+{
+	if (row->pcs)
+		return V_OK;
+
+	row->pcs = malloc(sizeof(struct v_piece));
+	if (!row->pcs)
+		return V_ERR;
+
+	row->npcs = 0;
+	if (row->len) {
+		row->pcs[0].s = row->orig;
+		row->pcs[0].len = row->len;
+		row->npcs = 1;
+	}
+	row->orig = NULL;
+
+	return V_OK;
+}
+
+static int v_pt_put(struct v_row *row, int k, char *s, int len)
+{
+	struct v_piece *tmp = realloc(row->pcs,
+				      sizeof(struct v_piece) * (row->npcs + 1));
+	if (!tmp)
+		return V_ERR;
+
+	row->pcs = tmp;
+	memmove(&row->pcs[k + 1], &row->pcs[k],
+		sizeof(struct v_piece) * (row->npcs - k));
+	row->pcs[k].s = s;
+	row->pcs[k].len = len;
+	row->npcs++;
+
+	return V_OK;
+}
+
+static void v_pt_drop(struct v_row *row, int k)
+{
+	memmove(&row->pcs[k], &row->pcs[k + 1],
+		sizeof(struct v_piece) * (row->npcs - k - 1));
+	row->npcs--;
+}
+
+static void v_pt_merge(struct v_row *row, int k)
+{
+	if (k < 0 || k + 1 >= row->npcs)
+		return;
+
+	struct v_piece *pc = &row->pcs[k];
+	if (pc->s + pc->len != pc[1].s)
+		return;
+
+	pc->len += pc[1].len;
+	v_pt_drop(row, k + 1);
+}
+
+static bool v_pt_at_tail(struct v_state *v, struct v_piece *pc, int len)
+{
+	return v->add && pc->s + pc->len == v->add->data + v->add->len &&
+	       v->add->cap - v->add->len >= (size_t)len;
+}
+
+/**
+ * v_pt_add - append a string to the piece table add buffer
+ * v: Pointer to the targeted v_state struct.
+ * s: String to be appended.
+ * len: Length of string s.
+ *
+ * Append a string to the piece table add buffer. The add buffer is an arena
+ * (see src/arena.c), so the returned address stays valid until v_pt_free() is
+ * called.
+ *
+ * Returns the address of the stored copy on success, NULL otherwise.
+ */
+char *v_pt_add(struct v_state *v, char *s, size_t len)
+{
+	if (!v)
+		return NULL;
+
+	return v_arena_add(&v->add, s, len);
+}
+
+/**
+ * v_pt_insert - insert a string into a piece table row
+ * v: Pointer to the targeted v_state struct.
+ * row: Pointer to the targeted v_row struct.
+ * x: Index to insert the string into.
+ * s: String to be inserted.
+ * len: Length of string s.
+ *
+ * Insert a string into a piece table row. The string is copied into the add
+ * buffer and a new piece referring to it is spliced in at x, splitting the
+ * piece under x when needed. When the piece right before x already ends at the
+ * tail of the add buffer, which is the case while typing, it is simply
+ * extended instead. The row is not rendered here.
+ *
+ * Returns the newly updated value of row->len on success, V_ERR otherwise.
+ */
+int v_pt_insert(struct v_state *v, struct v_row *row, int x, char *s, int len)
+{
+	if (!v || !row || !s || x < 0 || x > row->len || len < 0)
+		return V_ERR;
+
+	if (!len)
+		return row->len;
+
+	if (v_pt_pieces(row) == V_ERR)
+		return V_ERR;
+
+	int k = 0;
+	int off = x;
+	while (k < row->npcs && off > row->pcs[k].len)
+		off -= row->pcs[k++].len;
+
+	if (k < row->npcs && off == row->pcs[k].len &&
+	    v_pt_at_tail(v, &row->pcs[k], len)) {
+		memcpy(&v->add->data[v->add->len], s, len);
+		v->add->len += len;
+		row->pcs[k].len += len;
+		row->len += len;
+		return row->len;
+	}
+
+	char *p = v_pt_add(v, s, len);
+	if (!p)
+		return V_ERR;
+
+	if (k == row->npcs || off == 0) {
+		if (v_pt_put(row, k, p, len) == V_ERR)
+			return V_ERR;
+	} else if (off == row->pcs[k].len) {
+		if (v_pt_put(row, k + 1, p, len) == V_ERR)
+			return V_ERR;
+	} else {
+		struct v_piece *pc = &row->pcs[k];
+		if (v_pt_put(row, k + 1, pc->s + off, pc->len - off) == V_ERR)
+			return V_ERR;
+		row->pcs[k].len = off;
+		if (v_pt_put(row, k + 1, p, len) == V_ERR)
+			return V_ERR;
+	}
+
+	row->len += len;
+
+	return row->len;
+}
+
+/**
+ * v_pt_delete - delete a range of characters from a piece table row
+ * v: Pointer to the targeted v_state struct.
+ * row: Pointer to the targeted v_row struct.
+ * x: Index of the first character to be deleted.
+ * len: Number of characters to be deleted.
+ *
+ * Delete a range of characters from a piece table row. Nothing inside the
+ * original or the add buffer is touched, the pieces covering the range are
+ * only trimmed, split or dropped. Neighbouring pieces which end up contiguous
+ * in memory are merged back together. The row is not rendered here.
+ *
+ * Returns the newly updated value of row->len on success, V_ERR otherwise.
+ */
+int v_pt_delete(struct v_state *v, struct v_row *row, int x, int len)
+{
+	if (!v || !row || x < 0 || len < 0 || x + len > row->len)
+		return V_ERR;
+
+	if (!len)
+		return row->len;
+
+	if (v_pt_pieces(row) == V_ERR)
+		return V_ERR;
+
+	int k = 0;
+	int pos = 0;
+	int left = len;
+
+	while (k < row->npcs && left > 0) {
+		struct v_piece *pc = &row->pcs[k];
+		if (pos + pc->len <= x) {
+			pos += pc->len;
+			k++;
+			continue;
+		}
+
+		int a = x - pos;
+		int cut = pc->len - a;
+		if (cut > left)
+			cut = left;
+		left -= cut;
+
+		if (a == 0 && cut == pc->len) {
+			v_pt_drop(row, k);
+		} else if (a == 0) {
+			pc->s += cut;
+			pc->len -= cut;
+		} else if (a + cut == pc->len) {
+			pc->len -= cut;
+			pos += pc->len;
+			k++;
+		} else {
+			if (v_pt_put(row, k + 1, pc->s + a + cut,
+				     pc->len - a - cut) == V_ERR)
+				return V_ERR;
+			row->pcs[k].len = a;
+			k++;
+		}
+	}
+
+	v_pt_merge(row, k - 1);
+	row->len -= len;
+
+	return row->len;
+}
+
+/**
+ * v_pt_append_row - append part of a row to a piece table row
+ * v: Pointer to the targeted v_state struct.
+ * dst: Pointer to the v_row struct to be appended into.
+ * src: Pointer to the v_row struct to be read from.
+ * at: Index inside src where the appended part begins.
+ *
+ * Append the text of src, starting from index at, to the end of dst. Only the
+ * pieces are copied, the text they refer to is shared between both rows. The
+ * row is not rendered here.
+ *
+ * Returns the newly updated value of dst->len on success, V_ERR otherwise.
+ */
+int v_pt_append_row(struct v_state *v, struct v_row *dst, struct v_row *src,
+		    int at)
+{
+	if (!v || !dst || !src || dst == src || at < 0 || at > src->len)
+		return V_ERR;
+
+	if (v_pt_pieces(dst) == V_ERR)
+		return V_ERR;
+
+	char *s = NULL;
+	int n = 0;
+	int off = 0;
+
+	for (int seg = 0; (n = v_row_seg(src, seg, &s)) != V_ERR; seg++) {
+		int skip = at - off;
+		off += n;
+		if (skip >= n)
+			continue;
+		if (skip < 0)
+			skip = 0;
+
+		if (v_pt_put(dst, dst->npcs, s + skip, n - skip) == V_ERR)
+			return V_ERR;
+		dst->len += n - skip;
+		v_pt_merge(dst, dst->npcs - 2);
+	}
+
+	return dst->len;
+}
+
+/**
+ * v_pt_free - release the piece table buffers of the specified v_state
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Release the original and add buffers of the specified v_state in bulk. No
+ * row may refer to them anymore once this function is called. A mapped
+ * original buffer is unmapped.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_pt_free(struct v_state *v)
+{
+	if (!v)
+		return V_ERR;
+
+	v_arena_free(&v->add);
+	if (v->mm && v->src)
+		munmap(v->src, v->src_len);
+	else
+		free(v->src);
+	v->src = NULL;
+	v->src_len = 0;
+
+	return V_OK;
+}
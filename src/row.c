@@ -22,9 +22,333 @@
 #include <stdlib.h>
 #include <stddef.h>
 #include <string.h>
+#include <limits.h>
 
 #include <void.h>
 
+#define V_ROW_MIN_CAP	16	/* Smallest gap buffer allocation */
+
+static void v_row_move_gap(struct v_row *row, int x)
+{
+	int glen = row->cap - row->len;
+
+	if (x < row->gap)
+		memmove(&row->orig[x + glen], &row->orig[x], row->gap - x);
+	else if (x > row->gap)
+		memmove(&row->orig[row->gap], &row->orig[row->gap + glen],
+			x - row->gap);
+
+	row->gap = x;
+}
+
+static int v_row_grow(struct v_row *row, int need)
+{
+	if (row->cap - row->len >= need)
+		return V_OK;
+
+	int cap = row->cap * 2;
+	if (cap < row->len + need)
+		cap = row->len + need;
+	if (cap < V_ROW_MIN_CAP)
+		cap = V_ROW_MIN_CAP;
+
+	/* A borrowed string is copied out into storage owned by the row */
+	char *tmp = realloc(row->cap ? row->orig : NULL, cap);
+	if (!tmp)
+		return V_ERR;
+	if (!row->cap && row->len)
+		memcpy(tmp, row->orig, row->len);
+
+	/* Keep the text after the gap flushed against the end of the buffer */
+	int tail = row->len - row->gap;
+	memmove(&tmp[cap - tail], &tmp[row->cap - tail], tail);
+	row->orig = tmp;
+	row->cap = cap;
+
+	return V_OK;
+}
+
+/**
+ * v_row_seg - get a contiguous segment of a v_row original string
+ * row: Pointer to the targeted v_row struct.
+ * i: Index of the segment, starting from 0.
+ * s: Pointer to where the segment start address will be saved.
+ *
+ * Get a contiguous segment of a v_row original string. Since row->orig is a gap
+ * buffer, or a list of pieces in piece table mode, its text is not contiguous
+ * in memory. Walk the segments starting from i = 0 until V_ERR is returned to
+ * read the whole string in order without copying it out. A segment may be
+ * empty.
+ *
+ * Returns the length of the segment saved in s, V_ERR if there is no segment i.
+ */
+int v_row_seg(struct v_row *row, int i, char **s)
+{
+	if (!row || i < 0)
+		return V_ERR;
+
+	if (row->pcs) {
+		if (i >= row->npcs)
+			return V_ERR;
+		*s = row->pcs[i].s;
+		return row->pcs[i].len;
+	}
+
+	if (!row->cap) {
+		if (i > 0)
+			return V_ERR;
+		*s = row->orig;
+		return row->len;
+	}
+
+	if (i > 1)
+		return V_ERR;
+
+	if (i == 0) {
+		*s = row->orig;
+		return row->gap;
+	}
+
+	*s = row->orig + row->gap + (row->cap - row->len);
+	return row->len - row->gap;
+}
+
+static int v_row_tab_at(struct v_row *row, int cx)
+{
+	int lo = 0;
+	int hi = row->ntabs;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (row->tabs[mid].cx < cx)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static int v_row_tab_add(struct v_row *row, int cx, int rx)
+{
+	if (row->ntabs == row->tcap) {
+		int cap = row->tcap ? row->tcap * 2 : 4;
+		struct v_tab *tmp = realloc(row->tabs, sizeof(struct v_tab) * cap);
+		if (!tmp)
+			return V_ERR;
+		row->tabs = tmp;
+		row->tcap = cap;
+	}
+
+	row->tabs[row->ntabs].cx = cx;
+	row->tabs[row->ntabs].rx = rx;
+	row->ntabs++;
+
+	return V_OK;
+}
+
+static int v_row_walk(struct v_row *row, int from, int rx, int cx, int to_rx)
+{
+	char *s = NULL;
+	int n = 0;
+	int off = 0;
+
+	for (int seg = 0; (n = v_row_seg(row, seg, &s)) != V_ERR; seg++) {
+		int skip = from - off;
+		off += n;
+		if (skip >= n)
+			continue;
+		if (skip < 0)
+			skip = 0;
+
+		char *p = s + skip;
+		char *end = s + n;
+		if (to_rx < 0 && end - p > cx - from)
+			end = p + (cx - from);
+
+		while (p < end) {
+			char *tab = memchr(p, '\t', end - p);
+			int run = (tab ? tab : end) - p;
+
+			if (to_rx >= 0 && to_rx < rx + run)
+				return from + (to_rx - rx);
+			rx += run;
+			from += run;
+			if (!tab)
+				break;
+
+			rx += V_TABSTP - rx % V_TABSTP;
+			if (to_rx >= 0 && to_rx < rx)
+				return from;
+			from++;
+			p = tab + 1;
+		}
+
+		if (to_rx < 0 && from == cx)
+			break;
+	}
+
+	return to_rx < 0 ? rx : from;
+}
+
+static int v_row_valid(struct v_row *row)
+{
+	if (row->stale == V_ROW_FRESH || row->stale > row->len)
+		return row->len;
+
+	return row->stale;
+}
+
+/**
+ * v_row_cx_to_rx - convert a v_row original index into a rendered column
+ * row: Pointer to the targeted v_row struct.
+ * cx: Index inside the original string.
+ *
+ * Convert an index inside the original string of a v_row into the matching
+ * column inside its rendered string. Every rendered row keeps an index of its
+ * tabs along with the column each of them ends at, so the conversion is a
+ * binary search through that index. Only the part of a row which was edited
+ * since its last rendering has to be walked, skipping from tab to tab with
+ * memchr().
+ *
+ * Returns the rendered column on success, V_ERR otherwise.
+ */
+int v_row_cx_to_rx(struct v_row *row, int cx)
+{
+	if (!row || cx < 0)
+		return V_ERR;
+
+	if (cx > row->len)
+		cx = row->len;
+
+	int valid = v_row_valid(row);
+	int from = cx < valid ? cx : valid;
+	int i = v_row_tab_at(row, from);
+	int base = i ? row->tabs[i - 1].cx + 1 : 0;
+	int rx = (i ? row->tabs[i - 1].rx : 0) + (from - base);
+
+	if (cx == from)
+		return rx;
+
+	return v_row_walk(row, from, rx, cx, -1);
+}
+
+/**
+ * v_row_rx_to_cx - convert a v_row rendered column into an original index
+ * row: Pointer to the targeted v_row struct.
+ * rx: Column inside the rendered string.
+ *
+ * Convert a column inside the rendered string of a v_row into the matching
+ * index inside its original string. A column falling inside the expansion of a
+ * tab maps to that tab, and a column past the end of the row maps to its end.
+ * Just like v_row_cx_to_rx(), this is a binary search through the tab index of
+ * the row.
+ *
+ * Returns the original index on success, V_ERR otherwise.
+ */
+int v_row_rx_to_cx(struct v_row *row, int rx)
+{
+	if (!row || rx < 0)
+		return V_ERR;
+
+	int lo = 0;
+	int hi = row->ntabs;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (row->tabs[mid].rx <= rx)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	int base = lo ? row->tabs[lo - 1].cx + 1 : 0;
+	int rbase = lo ? row->tabs[lo - 1].rx : 0;
+	int cx = base + (rx - rbase);
+	if (lo < row->ntabs)
+		return cx < row->tabs[lo].cx ? cx : row->tabs[lo].cx;
+
+	int valid = v_row_valid(row);
+	if (cx <= valid)
+		return cx;
+
+	cx = v_row_walk(row, valid, rbase + (valid - base), 0, rx);
+
+	return cx < row->len ? cx : row->len;
+}
+
+static int v_render_seg(struct v_row *row, char *s, int n, int cx, int rx,
+			char *ren)
+{
+	for (int i = 0; i < n; i++) {
+		if (s[i] != '\t') {
+			if (ren)
+				ren[rx] = s[i];
+			rx++;
+			continue;
+		}
+
+		do {
+			if (ren)
+				ren[rx] = ' ';
+			rx++;
+		} while (rx % V_TABSTP);
+
+		if (ren && v_row_tab_add(row, cx + i, rx) == V_ERR)
+			return V_ERR;
+	}
+
+	return rx;
+}
+
+static int v_render_from(struct v_row *row, int from, int rx, char *ren)
+{
+	char *s = NULL;
+	int n = 0;
+	int off = 0;
+
+	for (int seg = 0; (n = v_row_seg(row, seg, &s)) != V_ERR; seg++) {
+		int skip = from - off;
+		off += n;
+		if (skip >= n)
+			continue;
+		if (skip < 0)
+			skip = 0;
+
+		rx = v_render_seg(row, s + skip, n - skip, off - n + skip, rx,
+				  ren);
+		if (rx == V_ERR)
+			return V_ERR;
+	}
+
+	return rx;
+}
+
+static char *v_row_flat(struct v_row *row)
+{
+	if (!row->len)
+		return "";
+
+	if (row->pcs)
+		return row->npcs == 1 ? row->pcs[0].s : NULL;
+
+	if (!row->cap || row->gap == row->len)
+		return row->orig;
+
+	if (!row->gap)
+		return row->orig + row->cap - row->len;
+
+	return NULL;
+}
+
+static void v_row_stale(struct v_row *row, int x)
+{
+	if (row->stale != V_ROW_FRESH && x >= row->stale)
+		return;
+
+	row->stale = x;
+	row->ntabs = v_row_tab_at(row, x);
+}
+
 /**
  * v_render_row - render the given v_row struct
  * v: Pointer to the targeted v_state struct.
@@ -36,54 +360,125 @@
  * value of V_TABSTP macro, a tab character will be rendered to match the
  * value of it. The rendered string result will be saved inside row->ren
  * meanwhile the length of the rendered string will be saved inside row->rlen.
- * Dirty flag will be setted to true.
+ * Rows are never rendered when they are edited, they are only flagged as
+ * stale from the first edited character onward. Rendering is deferred until a
+ * row actually gets drawn on screen, so rows which are never scrolled to never
+ * allocate a rendered string. Only the stale suffix is expanded again, into
+ * the existing row->ren allocation whenever it is big enough. When the text
+ * of orig is contiguous and rendering it would not change a single byte, which
+ * is the case of most tab-free lines, row->ren simply points at orig instead
+ * and row->rcap is 0. Such a row->ren is not NUL-terminated and is only valid
+ * until the row gets edited. The editor dirty flag is left untouched.
  *
  * Returns V_OK on success, V_ERR otherwise.
  */
 int v_render_row(struct v_state *v, struct v_row *row)
 {
-	int tabs = 0;
-	for (int i = 0; i < row->len; i++)
-		if (row->orig[i] == '\t')
-			tabs++;
-	free(row->ren);
-	v->dirty = true;
-	row->ren = malloc(row->len + tabs * (V_TABSTP - 1) + 1);
-	if (!row->ren)
-		return V_ERR;
+	(void)v;	/* Silence compiler warning */
 
-	int idx = 0;
-	for (int i = 0; i < row->len; i++) {
-		if (row->orig[i] != '\t') {
-			row->ren[idx++] = row->orig[i];
-			continue;
-		}
-		row->ren[idx++] = ' ';
-		while (idx % V_TABSTP)
-			row->ren[idx++] = ' ';
+	int from = row->stale;
+	if (from == V_ROW_FRESH)
+		return V_OK;
+	if (!row->ren || from < 0 || from > row->len)
+		from = 0;
+
+	/* A shared row->ren means the text before from has no tab */
+	char *flat = v_row_flat(row);
+	int chk = row->rcap ? 0 : from;
+	if (flat && (chk >= row->len ||
+		     !memchr(flat + chk, '\t', row->len - chk))) {
+		if (row->rcap)
+			free(row->ren);
+		row->ren = flat;
+		row->rlen = row->len;
+		row->rcap = 0;
+		row->stale = V_ROW_FRESH;
+		return V_OK;
 	}
 
-	row->ren[idx] = '\0';
-	row->rlen = idx;
+	if (!row->rcap) {
+		row->ren = NULL;
+		from = 0;
+	}
+	row->ntabs = v_row_tab_at(row, from);
+
+	int rx = from ? v_row_cx_to_rx(row, from) : 0;
+	int rlen = v_render_from(row, from, rx, NULL);
+
+	if (rlen + 1 > row->rcap) {
+		int cap = row->rcap * 2;
+		if (cap < rlen + 1)
+			cap = rlen + 1;
+
+		char *tmp = realloc(row->ren, cap);
+		if (!tmp)
+			return V_ERR;
+		row->ren = tmp;
+		row->rcap = cap;
+	}
+
+	if (v_render_from(row, from, rx, row->ren) == V_ERR) {
+		row->ntabs = v_row_tab_at(row, from);
+		return V_ERR;
+	}
+	row->ren[rlen] = '\0';
+	row->rlen = rlen;
+	row->stale = V_ROW_FRESH;
 
 	return V_OK;
 }
 
+static struct v_row *v_new_row(struct v_state *v, int y)
+{
+	struct v_row *row = v_tree_insert(v, y);
+	if (!row)
+		return NULL;
+
+	v->dirty = true;
+
+	return row;
+}
+
+static void v_release_row(struct v_row *row)
+{
+	if (row->cap)
+		free(row->orig);
+	free(row->pcs);
+	if (row->rcap)
+		free(row->ren);
+	free(row->tabs);
+
+	row->orig = NULL;
+	row->tabs = NULL;
+	row->ren = NULL;
+	row->pcs = NULL;
+	row->len = 0;
+	row->rlen = 0;
+	row->cap = 0;
+	row->gap = 0;
+	row->npcs = 0;
+	row->rcap = 0;
+	row->ntabs = 0;
+	row->tcap = 0;
+	row->stale = 0;
+}
+
 /**
  * v_insert_row - insert a new v_row into the specified v_state rows array
  * v: Pointer to the targeted v_state struct.
- * y: The insertion index inside v->rows.
+ * y: The line number of the new row.
  * s: String to be save.
  * len: Length of string s.
  *
- * Insert a brand new v_row struct into the specified v_state rows array.
+ * Insert a brand new v_row struct into the specified v_state row tree.
  * Do note that by calling this function, v->dirty flag will be setted to
  * true automatically because this function had completely no idea of what
  * you're trying to achieve when it comes to inserting a brand new v_row. It
  * would just assume that you wanted to add a new line for editing purposes,
  * so it flicks on the v->dirty flag. Make sure the given len is big enough to
- * store the string s. Insertion in the middle of v->rows array is supported
- * here.
+ * store the string s. Insertion in the middle of the buffer is supported
+ * here, and only costs logarithmic time. In piece table mode, string s is
+ * copied into the add buffer instead.
  *
  * Returns the updated number of v->nrows on success, V_ERR otherwise.
  */
@@ -92,105 +487,236 @@ int v_insert_row(struct v_state *v, int y, char *s, size_t len)
 	if (!v || !s || y < 0 || y > v->nrows)
 		return V_ERR;
 
-	struct v_row *tmp = realloc(v->rows,
-			sizeof(struct v_row) * (v->nrows + 1));
-	if (!tmp)
+	if (v->pt) {
+		char *p = v_pt_add(v, s, len);
+		if (len && !p)
+			return V_ERR;
+		return v_insert_row_ref(v, y, p, len);
+	}
+
+	char *orig = NULL;
+	if (len) {
+		orig = malloc(len);
+		if (!orig)
+			return V_ERR;
+		memcpy(orig, s, len);
+	}
+
+	struct v_row *row = v_new_row(v, y);
+	if (!row) {
+		free(orig);
 		return V_ERR;
+	}
 
-	v->rows = tmp;
-	tmp = NULL;
+	row->orig = orig;
+	row->len = len;
+	row->cap = len;
+	row->gap = len;
+	row->stale = 0;
+	row = NULL;
 
-	memmove(&v->rows[y + 1], &v->rows[y],
-		sizeof(struct v_row) * (v->nrows - y));
+	return v->nrows;
+}
+
+/**
+ * v_insert_row_ref - insert a new v_row borrowing the given string
+ * v: Pointer to the targeted v_state struct.
+ * y: The line number of the new row.
+ * s: String to be referred to.
+ * len: Length of string s.
+ *
+ * Insert a brand new v_row struct into the specified v_state row tree just
+ * like v_insert_row() does, except string s is not copied. The row refers to it
+ * as borrowed read-only storage, so s must stay untouched for as long as the
+ * row exists. The row only takes a copy of its own once it gets edited. The
+ * editor dirty flag will be turned on.
+ *
+ * Returns the updated number of v->nrows on success, V_ERR otherwise.
+ */
+int v_insert_row_ref(struct v_state *v, int y, char *s, size_t len)
+{
+	if (!v || (!s && len) || y < 0 || y > v->nrows)
+		return V_ERR;
 
-	struct v_row *row = &v->rows[y];
+	struct v_row *row = v_new_row(v, y);
+	if (!row)
+		return V_ERR;
+
+	row->orig = s;
 	row->len = len;
+	row->gap = len;
+	row->stale = 0;
+
+	return v->nrows;
+}
+
+static int v_insert_batch(struct v_state *v, int y, struct v_line *lines,
+			  int n, bool ref)
+{
+	struct v_row batch[V_LEAF_MAX];
+
+	while (n > 0) {
+		int k = n < V_LEAF_MAX ? n : V_LEAF_MAX;
+		memset(batch, 0, sizeof(struct v_row) * k);
+
+		for (int i = 0; i < k; i++) {
+			struct v_row *row = &batch[i];
+			char *s = lines[i].s;
+			size_t len = lines[i].len;
+
+			if (len && !ref)
+				s = v_arena_line(v->pt ? &v->add : &v->arena,
+						 s, len);
+
+			if (len && !s)
+				return V_ERR;
+
+			row->orig = len ? s : NULL;
+			row->len = len;
+			row->gap = len;
+		}
+
+		if (v_tree_insert_rows(v, y, batch, k) == V_ERR)
+			return V_ERR;
+
+		y += k;
+		lines += k;
+		n -= k;
+	}
+
 	v->dirty = true;
-	row->orig = malloc(len + 1);
-	if (!row->orig)
+
+	return v->nrows;
+}
+
+/**
+ * v_append_rows - append a batch of new v_rows to the specified v_state
+ * v: Pointer to the targeted v_state struct.
+ * lines: The lines to be appended, in order.
+ * n: Number of lines inside lines.
+ *
+ * Append a batch of new v_rows at the end of the specified v_state row tree,
+ * copying the text of each line. The text is copied into the v->arena arena
+ * (or the add buffer in piece table mode) rather than malloc()ed row by row,
+ * and the rows borrow it until they get edited. The rows are handed to the
+ * tree one whole leaf at a time, which makes this the fast path for loading a
+ * file or pasting many lines at once. The editor dirty flag will be turned
+ * on.
+ *
+ * Returns the updated number of v->nrows on success, V_ERR otherwise.
+ */
+int v_append_rows(struct v_state *v, struct v_line *lines, int n)
+{
+	if (!v || (!lines && n) || n < 0)
 		return V_ERR;
 
-	memcpy(row->orig, s, len);
-	row->orig[len] = '\0';
-	row->ren = NULL;
-	row->rlen = 0;
-	if (v_render_row(v, row) == V_ERR)
+	return v_insert_batch(v, v->nrows, lines, n, false);
+}
+
+/**
+ * v_append_rows_ref - append a batch of new v_rows borrowing the given lines
+ * v: Pointer to the targeted v_state struct.
+ * lines: The lines to be referred to, in order.
+ * n: Number of lines inside lines.
+ *
+ * Append a batch of new v_rows at the end of the specified v_state row tree
+ * just like v_append_rows() does, except the text of the lines is not copied.
+ * See v_insert_row_ref() for the rules on borrowed storage. The editor dirty
+ * flag will be turned on.
+ *
+ * Returns the updated number of v->nrows on success, V_ERR otherwise.
+ */
+int v_append_rows_ref(struct v_state *v, struct v_line *lines, int n)
+{
+	if (!v || (!lines && n) || n < 0)
 		return V_ERR;
 
-	v->nrows++;
-	row = NULL;
+	return v_insert_batch(v, v->nrows, lines, n, true);
+}
 
-	return v->nrows;
+/**
+ * v_insert_rows_ref - insert a batch of new v_rows borrowing the given lines
+ * v: Pointer to the targeted v_state struct.
+ * y: The line number of the first new row.
+ * lines: The lines to be referred to, in order.
+ * n: Number of lines inside lines.
+ *
+ * Insert a batch of new v_rows at line y, just like v_append_rows_ref() does
+ * at the end of the row tree. The rows are handed to the tree one whole leaf
+ * at a time as well, making this the fast path for pasting many lines in the
+ * middle of the buffer. See v_insert_row_ref() for the rules on borrowed
+ * storage. The editor dirty flag will be turned on.
+ *
+ * Returns the updated number of v->nrows on success, V_ERR otherwise.
+ */
+int v_insert_rows_ref(struct v_state *v, int y, struct v_line *lines, int n)
+{
+	if (!v || (!lines && n) || n < 0 || y < 0 || y > v->nrows)
+		return V_ERR;
+
+	return v_insert_batch(v, y, lines, n, true);
 }
 
 /**
- * v_del_row - delete a v_row struct from a v_state rows array
+ * v_del_row - delete a v_row struct from a v_state row tree
  * v: Pointer to the targeted v_state struct.
- * y: The index of the targeted v_row struct inside v->rows.
+ * y: The line number of the targeted v_row struct.
  *
- * Deletes the specified v_row struct from the targeted v_state's rows
- * array. This function shall free() the allocated memories of the specified
- * v_row and sets them to NULL. The length of the v_row strings also will be
- * setted to 0. The entire v->rows array shall be move, overlapping the deleted
- * one. The editor dirty flag also will be flicked to true.
+ * Deletes the specified v_row struct from the targeted v_state's row tree.
+ * This function shall free() the allocated memories of the specified v_row
+ * and sets them to NULL. The length of the v_row strings also will be setted
+ * to 0. Only the rows sharing the same tree leaf are moved, overlapping the
+ * deleted one. The editor dirty flag also will be flicked to true.
  *
  * Returns the newly updated number of v->nrows on success, V_ERR otherwise.
  */
 int v_del_row(struct v_state *v, int y)
 {
-	if (!v || !v->rows || y < 0 || y >= v->nrows)
+	if (!v || !v->root || y < 0 || y >= v->nrows)
 		return V_ERR;
 
-	struct v_row *row = &v->rows[y];
-	free(row->orig);
-	free(row->ren);
-
-	row->orig = NULL;
-	row->ren = NULL;
-	row->len = 0;
-	row->rlen = 0;
-
-	memmove(row, &v->rows[y + 1],
-		sizeof(struct v_row) * (v->nrows - y - 1));
+	v_release_row(v_row_at(v, y));
+	if (v_tree_delete(v, y) == V_ERR)
+		return V_ERR;
 
-	v->nrows--;
 	v->dirty = true;
 
 	return v->nrows;
 }
 
 /**
- * v_free_rows - free the entire rows array inside the specified v_state
+ * v_free_rows - free the entire row tree inside the specified v_state
  * v: Pointer to the targeted v_state struct.
  *
- * Free the entire rows array inside the specified v_state. v->dirty flag shall
- * be setted to false. Use this function whenever you find the need to free()
- * everything.
+ * Free the entire row tree inside the specified v_state, along with the arena
+ * and piece table buffers the rows may refer to. Rows which were never edited
+ * own no storage of their own, their text goes away in bulk with the arena.
+ * v->dirty flag shall be setted to false. Use this function whenever you find
+ * the need to free() everything.
  *
  * Returns V_OK on success, V_ERR otherwise.
  */
 int v_free_rows(struct v_state *v)
 {
-	if (!v || !v->rows)
+	if (!v)
 		return V_OK;
 
 	if (v->nrows < 0)
 		return V_ERR;
 
-	for (int i = 0; i < v->nrows; i++) {
-		struct v_row *row = &v->rows[i];
-		free(row->orig);
-		free(row->ren);
-		row->orig = NULL;
-		row->ren = NULL;
-		row->len = 0;
-		row->rlen = 0;
-		row = NULL;
-	}
+	v_load_stop(v);
+	v_page_close(v);
+	v_follow_stop(v);
+
+	/* The saver thread may still be reading the rows */
+	v_save_poll(v, true);
 
-	v->nrows = 0;
-	free(v->rows);
-	v->rows = NULL;
+	for (int i = 0; i < v->nrows; i++)
+		v_release_row(v_row_at(v, i));
+
+	v_tree_free(v);
+	v_arena_free(&v->arena);
+	v_pt_free(v);
 	v->dirty = false;
 
 	return V_OK;
@@ -203,12 +729,11 @@ int v_free_rows(struct v_state *v)
  * x: The index to insert the char into.
  * c: Char to be inserted with.
  *
- * Insert a char into a v_row at the given position. This function will
- * realloc() the memory of the specified v_row string automatically before
- * the insertion is carried out. All of the characters within the original
- * string will be moved to create a room for the new character insertion.
- * The original string then will be rendered automatically. Please take note
- * that this function will turn on the editor dirty flag.
+ * Insert a char into a v_row at the given position. The gap of the original
+ * string is moved to x first, so a run of insertions at the same spot only
+ * costs a single byte write each. The gap buffer is grown geometrically when it
+ * runs out of room. The row then will be flagged for rendering.
+ * Please take note that this function will turn on the editor dirty flag.
  *
  * Returns newly updated number of row->len on success, V_ERR otherwise.
  */
@@ -217,16 +742,69 @@ int v_row_insert_char(struct v_state *v, struct v_row *row, int x, int c)
 	if (x < 0 || x > row->len)
 		x = row->len;
 
-	char *tmp = realloc(row->orig, row->len + 2);
-	if (!tmp)
+	char ch = c;
+	if (v->pt) {
+		if (v_pt_insert(v, row, x, &ch, 1) == V_ERR)
+			return V_ERR;
+		goto done;
+	}
+
+	if (v_row_grow(row, 1) == V_ERR)
 		return V_ERR;
 
-	row->orig = tmp;
-	memmove(&row->orig[x + 1], &row->orig[x], row->len - x + 1);
+	v_row_move_gap(row, x);
+	row->orig[row->gap++] = ch;
 	row->len++;
-	row->orig[x] = c;
+
+done:
+	v->dirty = true;
+	v_row_stale(row, x);
+
+	return row->len;
+}
+
+/**
+ * v_row_insert_str - insert a string into a v_row at the given position
+ * v: Pointer to the targeted v_state struct.
+ * row: Pointer to the targeted v_row struct.
+ * x: The index to insert the string into.
+ * s: String to be inserted with.
+ * len: The length of string s.
+ *
+ * Insert a string into a v_row at the given position, just like inserting its
+ * chars one by one with v_row_insert_char() would, except the gap is moved and
+ * grown only once for the whole string. The row then will be flagged for
+ * rendering. Please take note that this function will turn on the editor dirty
+ * flag.
+ *
+ * Returns newly updated number of row->len on success, V_ERR otherwise.
+ */
+int v_row_insert_str(struct v_state *v, struct v_row *row, int x, char *s,
+		     size_t len)
+{
+	if (!row || !s || len > (size_t)(INT_MAX - row->len))
+		return V_ERR;
+
+	if (x < 0 || x > row->len)
+		x = row->len;
+
+	if (v->pt) {
+		if (v_pt_insert(v, row, x, s, len) == V_ERR)
+			return V_ERR;
+		goto done;
+	}
+
+	if (v_row_grow(row, len) == V_ERR)
+		return V_ERR;
+
+	v_row_move_gap(row, x);
+	memcpy(&row->orig[row->gap], s, len);
+	row->gap += len;
+	row->len += len;
+
+done:
 	v->dirty = true;
-	v_render_row(v, row);
+	v_row_stale(row, x);
 
 	return row->len;
 }
@@ -243,8 +821,8 @@ int v_row_insert_char(struct v_state *v, struct v_row *row, int x, int c)
  * example would be backspacing at the beginning of a line. This is just the
  * common use case of this function, feel free to use it whenever needed. In
  * the end this function simply append the string s to the specified v_row's
- * original string before rendering them and that's all it does. Please take
- * note that this function will turn on the editor dirty flag.
+ * original string before flagging it for rendering and that's all it does.
+ * Please take note that this function will turn on the editor dirty flag.
  *
  * Returns the new length of the original updated string on success, V_ERR
  * otherwise.
@@ -254,20 +832,76 @@ int v_row_append_str(struct v_state *v, struct v_row *row, char *s, size_t len)
 	if (!row || !s)
 		return V_ERR;
 
-	char *tmp = realloc(row->orig, row->len + len + 1);
-	if (!tmp)
+	int at = row->len;
+	if (v->pt) {
+		if (v_pt_insert(v, row, row->len, s, len) == V_ERR)
+			return V_ERR;
+		goto done;
+	}
+
+	if (v_row_grow(row, len) == V_ERR)
 		return V_ERR;
 
-	row->orig = tmp;
-	memcpy(&row->orig[row->len], s, len);
+	v_row_move_gap(row, row->len);
+	memcpy(&row->orig[row->gap], s, len);
+	row->gap += len;
 	row->len += len;
-	row->orig[row->len] = '\0';
+
+done:
 	v->dirty = true;
+	v_row_stale(row, at);
 
-	if (v_render_row(v, row) == V_ERR)
+	return row->len;
+}
+
+/**
+ * v_row_append_row - append part of a v_row string to another v_row
+ * v: Pointer to the targeted v_state struct.
+ * dst: Pointer to the v_row struct to be appended into.
+ * src: Pointer to the v_row struct to be read from.
+ * at: Index inside src where the appended part begins.
+ *
+ * Append the original string of src, starting from index at until its end, to
+ * the end of dst. The text is read straight out of the src segments, so there
+ * is no need to flatten src beforehand. In piece table mode, only the pieces of
+ * src are appended and the text itself is shared. dst and src must be two
+ * different v_row structs. This function will turn on the editor dirty flag.
+ *
+ * Returns the new length of dst original string on success, V_ERR otherwise.
+ */
+int v_row_append_row(struct v_state *v, struct v_row *dst, struct v_row *src,
+		     int at)
+{
+	if (!dst || !src || dst == src || at < 0 || at > src->len)
 		return V_ERR;
 
-	return row->len;
+	if (v->pt) {
+		int from = dst->len;
+		if (v_pt_append_row(v, dst, src, at) == V_ERR)
+			return V_ERR;
+		v->dirty = true;
+		v_row_stale(dst, from);
+		return dst->len;
+	}
+
+	char *s = NULL;
+	int n = 0;
+	int off = 0;
+
+	for (int seg = 0; (n = v_row_seg(src, seg, &s)) != V_ERR; seg++) {
+		int skip = at - off;
+		off += n;
+		if (skip >= n)
+			continue;
+		if (skip < 0)
+			skip = 0;
+		if (v_row_append_str(v, dst, s + skip, n - skip) == V_ERR)
+			return V_ERR;
+	}
+
+	v->dirty = true;
+
+	return dst->len;
 }
 
 /**
@@ -277,10 +911,11 @@ int v_row_append_str(struct v_state *v, struct v_row *row, char *s, size_t len)
  * x: Index to delete the char from.
  *
  * Delete a char inside the specified v_row at a given position. We don't
- * technically delete the char actually. We simply just move the entire string
- * so that it overlaps that one character we wanted to delete out. Then, we
- * simply decrement the original string length and re-render it. Again, please
- * take note that this function will *turn* on the editor dirty flag.
+ * technically delete the char actually. We simply move the gap right after the
+ * deleted char and widen it by one so that the char falls inside of it. Then,
+ * we simply decrement the original string length and flag it for rendering.
+ * Again, please take note that this function will *turn* on the editor dirty
+ * flag.
  *
  * Returns the newly updated value of row->len on success, V_ERR otherwise.
  */
@@ -289,10 +924,60 @@ int v_row_del_char(struct v_state *v, struct v_row *row, int x)
 	if (x < 0 || x >= row->len)
 		return V_ERR;
 
-	memmove(&row->orig[x], &row->orig[x + 1], row->len - x);
+	if (v->pt) {
+		if (v_pt_delete(v, row, x, 1) == V_ERR)
+			return V_ERR;
+		goto done;
+	}
+
+	if (!row->cap && v_row_grow(row, 1) == V_ERR)
+		return V_ERR;
+
+	v_row_move_gap(row, x + 1);
+	row->gap--;
 	row->len--;
+
+done:
+	v->dirty = true;
+	v_row_stale(row, x);
+
+	return row->len;
+}
+
+/**
+ * v_row_truncate - cut the specified v_row string off at a given position
+ * v: Pointer to the targeted v_state struct.
+ * row: Pointer to the targeted v_row struct.
+ * at: Index where the original string will end.
+ *
+ * Cut the specified v_row string off at a given position, discarding every
+ * character from index at until the end of the line. The gap simply swallows
+ * the discarded characters, while a borrowed string is only shortened. The row
+ * will be flagged for rendering and the editor dirty flag will be turned on.
+ *
+ * Returns the newly updated value of row->len on success, V_ERR otherwise.
+ */
+int v_row_truncate(struct v_state *v, struct v_row *row, int at)
+{
+	if (!row || at < 0 || at > row->len)
+		return V_ERR;
+
+	if (v->pt) {
+		if (v_pt_delete(v, row, at, row->len - at) == V_ERR)
+			return V_ERR;
+		goto done;
+	}
+
+	if (row->gap > at || !row->cap)
+		row->gap = at;
+	else
+		v_row_move_gap(row, at);
+
+	row->len = at;
+
+done:
 	v->dirty = true;
-	v_render_row(v, row);
+	v_row_stale(row, at);
 
 	return row->len;
 }
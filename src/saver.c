@@ -0,0 +1,321 @@
+/*
+ * saver.c - Background file saving routines
+ *
+ * This file provides the background saver, which lets the editing go on while
+ * a file is being written. Saving starts by taking a snapshot of the buffer
+ * content: the text the rows borrow from the read-only file content, the
+ * arena or the add buffer never changes, so the snapshot simply refers to it,
+ * and only the text of the rows being edited is copied. A saver thread then
+ * writes the snapshot out through v_save_snap() without ever touching the
+ * v_state struct, and the editor thread picks the outcome up every time it
+ * goes around its main loop.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/uio.h>
+
+#include <void.h>
+
+static char v_snap_nl[] = "\n";
+
+/* Whether from..to lies inside a single block of the rows storage */
+static bool v_snap_within(struct v_state *v, struct v_snap *snap, char *from,
+			  char *to)
+{
+	if (from >= snap->lo && to <= snap->hi)
+		return true;
+
+	char *lo = NULL;
+	char *hi = NULL;
+	if (v->src && from >= v->src && to <= v->src + v->src_len) {
+		lo = v->src;
+		hi = v->src + v->src_len;
+	}
+
+	struct v_blk *arenas[] = {v->arena, v->add};
+	for (int i = 0; i < 2 && !lo; i++) {
+		for (struct v_blk *blk = arenas[i]; blk; blk = blk->next) {
+			if (from >= blk->data && to <= blk->data + blk->len) {
+				lo = blk->data;
+				hi = blk->data + blk->len;
+				break;
+			}
+		}
+	}
+
+	if (!lo)
+		return false;
+
+	/* Rows mostly come in the order their text was stored */
+	snap->lo = lo;
+	snap->hi = hi;
+
+	return true;
+}
+
+static int v_snap_add(struct v_state *v, struct v_snap *snap, char *s,
+		      size_t len)
+{
+	snap->len += len;
+
+	/* Text following the previous piece in memory just extends it */
+	struct iovec *last = snap->n ? &snap->iov[snap->n - 1] : NULL;
+	if (last && (char *)last->iov_base + last->iov_len == s) {
+		last->iov_len += len;
+		return V_OK;
+	}
+
+	/*
+	 * So does text found one byte after the piece before a "\n", when that
+	 * byte is a '\n' too. The byte in between is only read when both
+	 * pieces lie inside the same block of storage.
+	 */
+	struct iovec *prev = last && snap->n > 1 ? last - 1 : NULL;
+	char *end = prev ? (char *)prev->iov_base + prev->iov_len : NULL;
+	if (last && last->iov_base == v_snap_nl && end + 1 == s &&
+	    v_snap_within(v, snap, prev->iov_base, s + len) && *end == '\n') {
+		prev->iov_len += 1 + len;
+		snap->n--;
+		return V_OK;
+	}
+
+	if (snap->n == snap->cap) {
+		size_t cap = snap->cap ? snap->cap * 2 : V_SAVE_IOV;
+		struct iovec *tmp = realloc(snap->iov,
+					    sizeof(struct iovec) * cap);
+		if (!tmp)
+			return V_ERR;
+		snap->iov = tmp;
+		snap->cap = cap;
+	}
+
+	snap->iov[snap->n].iov_base = s;
+	snap->iov[snap->n].iov_len = len;
+	snap->n++;
+
+	return V_OK;
+}
+
+static int v_snap_copy(struct v_state *v, struct v_snap *snap, char *s,
+		       size_t len)
+{
+	char *p = v_arena_add(&snap->text, s, len);
+	if (!p)
+		return V_ERR;
+
+	return v_snap_add(v, snap, p, len);
+}
+
+static int v_snap_row(struct v_state *v, struct v_snap *snap,
+		      struct v_row *row)
+{
+	/* A gap buffer changes with every edit, the rest never does */
+	bool copy = row->cap && !row->pcs;
+	char *s = NULL;
+	int n = 0;
+
+	for (int seg = 0; (n = v_row_seg(row, seg, &s)) != V_ERR; seg++) {
+		if (!n)
+			continue;
+		if ((copy ? v_snap_copy(v, snap, s, n) :
+			    v_snap_add(v, snap, s, n)) == V_ERR)
+			return V_ERR;
+	}
+
+	if (copy)
+		return v_snap_copy(v, snap, v_snap_nl, 1);
+
+	return v_snap_add(v, snap, v_snap_nl, 1);
+}
+
+/**
+ * v_snap_take - take a snapshot of the buffer content
+ * v: Pointer to the targeted v_state struct.
+ * snap: Pointer to where the snapshot will be saved.
+ *
+ * Take a snapshot of the buffer content, made of the pieces of text found in
+ * the rows followed by their line terminators. The pieces which can't change
+ * anymore are referred to rather than copied, and consecutive pieces found
+ * right next to each other in memory are merged, so a file which wasn't
+ * edited much only needs a handful of them. The text of the rows being edited
+ * is copied into the snapshot own arena. The snapshot stays valid as long as
+ * the rows storage is not released, and must be released with v_snap_free().
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_snap_take(struct v_state *v, struct v_snap *snap)
+{
+	if (!v || !snap)
+		return V_ERR;
+
+	memset(snap, 0, sizeof(struct v_snap));
+	snap->nrows = v->nrows;
+
+	for (int y = 0; y < v->nrows; y++) {
+		if (v_snap_row(v, snap, v_row_at(v, y)) == V_ERR) {
+			v_snap_free(snap);
+			errno = ENOMEM;
+			return V_ERR;
+		}
+	}
+
+	return V_OK;
+}
+
+/**
+ * v_snap_free - release a snapshot of the buffer content
+ * snap: Pointer to the targeted snapshot.
+ *
+ * Release the pieces of a snapshot taken by v_snap_take() along with the text
+ * it copied. The snapshot is left empty.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_snap_free(struct v_snap *snap)
+{
+	if (!snap)
+		return V_ERR;
+
+	free(snap->iov);
+	v_arena_free(&snap->text);
+	memset(snap, 0, sizeof(struct v_snap));
+
+	return V_OK;
+}
+
+static void *v_save_run(void *arg)
+{
+	struct v_saver *sv = arg;
+	int err = v_save_snap(&sv->snap, sv->path, sv->sync, sv->mapped) ==
+		  V_ERR ? errno : 0;
+
+	pthread_mutex_lock(&sv->lock);
+	sv->err = err;
+	sv->end = true;
+	pthread_cond_broadcast(&sv->cond);
+	pthread_mutex_unlock(&sv->lock);
+
+	return NULL;
+}
+
+static void v_save_free(struct v_state *v)
+{
+	struct v_saver *sv = v->sv;
+
+	if (sv->started)
+		pthread_join(sv->tid, NULL);
+
+	v_snap_free(&sv->snap);
+	free(sv->path);
+	pthread_mutex_destroy(&sv->lock);
+	pthread_cond_destroy(&sv->cond);
+	free(sv);
+	v->sv = NULL;
+}
+
+/**
+ * v_save_start - start saving the buffer content in the background
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Start saving the buffer content into v->filename in the background. A
+ * snapshot of the buffer content is taken with v_snap_take(), then handed to
+ * a saver thread which writes it with v_save_snap(). A save still running is
+ * waited for first. The editor dirty flag is turned off right away, since
+ * the snapshot holds every change made so far. Should no thread be started,
+ * the snapshot is written right here instead.
+ *
+ * Returns V_OK on success, V_ERR with errno set otherwise.
+ */
+int v_save_start(struct v_state *v)
+{
+	if (!v || !v->filename) {
+		errno = EINVAL;
+		return V_ERR;
+	}
+
+	/* One save at a time, in the order they were asked for */
+	v_save_poll(v, true);
+
+	struct v_saver *sv = calloc(1, sizeof(struct v_saver));
+	if (!sv)
+		return V_ERR;
+
+	sv->path = strdup(v->filename);
+	if (!sv->path || v_snap_take(v, &sv->snap) == V_ERR) {
+		free(sv->path);
+		free(sv);
+		errno = ENOMEM;
+		return V_ERR;
+	}
+
+	sv->sync = v->sync;
+	sv->mapped = v->mm && v->src;
+	v_jrnl_mark(v);
+	pthread_mutex_init(&sv->lock, NULL);
+	pthread_cond_init(&sv->cond, NULL);
+	v->sv = sv;
+	v->dirty = false;
+
+	sv->started = !pthread_create(&sv->tid, NULL, v_save_run, sv);
+	if (!sv->started)
+		v_save_run(sv);
+
+	return V_OK;
+}
+
+/**
+ * v_save_poll - report the outcome of the background saving
+ * v: Pointer to the targeted v_state struct.
+ * wait: Whether to wait for the saving to be done.
+ *
+ * Report the outcome of the saving started by v_save_start() through the
+ * status message once it is done, and join the saver thread. A failed save
+ * turns the editor dirty flag back on. Does nothing when no file is being
+ * saved, or when it is still being written and wait is false.
+ *
+ * Returns V_OK on success, V_ERR if the saving failed.
+ */
+int v_save_poll(struct v_state *v, bool wait)
+{
+	if (!v)
+		return V_ERR;
+
+	struct v_saver *sv = v->sv;
+	if (!sv)
+		return V_OK;
+
+	pthread_mutex_lock(&sv->lock);
+	while (wait && !sv->end)
+		pthread_cond_wait(&sv->cond, &sv->lock);
+	bool end = sv->end;
+	pthread_mutex_unlock(&sv->lock);
+
+	if (!end)
+		return V_OK;
+
+	int ret = V_OK;
+	if (sv->err) {
+		v_set_stats_msg(v, "ERR: %s", strerror(sv->err));
+		v->dirty = true;
+		ret = V_ERR;
+	} else {
+		v_set_stats_msg(v, "%dL %lldB written out to disk",
+				sv->snap.nrows, (long long)sv->snap.len);
+		v_jrnl_saved(v);
+	}
+
+	v_save_free(v);
+
+	return ret;
+}
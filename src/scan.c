@@ -0,0 +1,429 @@
+/*
+ * scan.c - Line boundary scanning routines
+ *
+ * This file provides the scanner splitting raw file content into lines, which
+ * is what every way of loading a file relies on. On x86 processors, 16 (SSE2)
+ * or 32 (AVX2) bytes are compared against '\n' and '\r' at once, and the
+ * resulting bit masks are walked to find the line ends along with the "\r\n"
+ * ones. The widest flavour the running processor supports is picked the first
+ * time a block is scanned. Other processors fall back to memchr(). Large blocks
+ * are cut into chunks indexed by threads of their own, whose lines are then
+ * handed over in order.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define V_SCAN_X86
+#include <immintrin.h>
+#endif
+
+#include <void.h>
+
+static char *(*v_scan_impl)(char *p, char *end, bool last,
+			    struct v_line *lines, int max, int *n);
+static pthread_once_t v_scan_once = PTHREAD_ONCE_INIT;
+
+static inline void v_scan_emit(char *s, char *nl, bool cr,
+			       struct v_line *lines, int *n)
+{
+	size_t len = nl - s;
+
+	/* "\r\r\n" is rare enough to be stripped one byte at a time */
+	if (cr) {
+		len--;
+		while (len > 0 && s[len - 1] == '\r')
+			len--;
+	}
+
+	lines[*n].s = s;
+	lines[*n].len = len;
+	(*n)++;
+}
+
+static char *v_scan_scalar(char *p, char *end, bool last,
+			   struct v_line *lines, int max, int *n)
+{
+	*n = 0;
+
+	while (p < end && *n < max) {
+		char *nl = memchr(p, '\n', end - p);
+		if (!nl && !last)
+			break;
+
+		char *eol = nl ? nl : end;
+		v_scan_emit(p, eol, eol > p && eol[-1] == '\r', lines, n);
+		p = nl ? nl + 1 : end;
+	}
+
+	return p;
+}
+
+#ifdef V_SCAN_X86
+/*
+ * Both flavours look at 64 bytes per round, building one bit mask for the
+ * '\n' in there and one for the '\r'. A '\n' is part of a "\r\n" when the
+ * bit right before its own is set in the '\r' mask, the last '\r' bit of a
+ * round being carried over to the next one.
+ */
+static inline char *v_scan_masks(char *p, char *q, uint64_t m, uint64_t crlf,
+				 struct v_line *lines, int max, int *n)
+{
+	while (m) {
+		int i = __builtin_ctzll(m);
+		v_scan_emit(p, q + i, crlf >> i & 1, lines, n);
+		p = q + i + 1;
+		if (*n == max)
+			break;
+		m &= m - 1;
+	}
+
+	return p;
+}
+
+__attribute__((target("sse2")))
+static inline uint64_t v_scan_mask16(char *q, __m128i c)
+{
+	uint64_t m = 0;
+
+	for (int i = 0; i < 4; i++) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(q + i * 16));
+		m |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, c))
+			<< (i * 16);
+	}
+
+	return m;
+}
+
+__attribute__((target("sse2")))
+static char *v_scan_sse2(char *p, char *end, bool last,
+			 struct v_line *lines, int max, int *n)
+{
+	const __m128i nl = _mm_set1_epi8('\n');
+	const __m128i cr = _mm_set1_epi8('\r');
+	uint64_t carry = 0;
+	char *q = p;
+
+	*n = 0;
+	while (end - q >= 64) {
+		uint64_t m = v_scan_mask16(q, nl);
+		uint64_t r = v_scan_mask16(q, cr);
+		uint64_t crlf = m & ((r << 1) | carry);
+
+		carry = r >> 63;
+		p = v_scan_masks(p, q, m, crlf, lines, max, n);
+		if (*n == max)
+			return p;
+		q += 64;
+	}
+
+	int k = 0;
+	p = v_scan_scalar(p, end, last, lines + *n, max - *n, &k);
+	*n += k;
+
+	return p;
+}
+
+__attribute__((target("avx2")))
+static inline uint64_t v_scan_mask32(char *q, __m256i c)
+{
+	__m256i lo = _mm256_loadu_si256((const __m256i *)q);
+	__m256i hi = _mm256_loadu_si256((const __m256i *)(q + 32));
+	uint32_t a = _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, c));
+	uint32_t b = _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, c));
+
+	return (uint64_t)b << 32 | a;
+}
+
+__attribute__((target("avx2")))
+static char *v_scan_avx2(char *p, char *end, bool last,
+			 struct v_line *lines, int max, int *n)
+{
+	const __m256i nl = _mm256_set1_epi8('\n');
+	const __m256i cr = _mm256_set1_epi8('\r');
+	uint64_t carry = 0;
+	char *q = p;
+
+	*n = 0;
+	while (end - q >= 64) {
+		uint64_t m = v_scan_mask32(q, nl);
+		uint64_t r = v_scan_mask32(q, cr);
+		uint64_t crlf = m & ((r << 1) | carry);
+
+		carry = r >> 63;
+		p = v_scan_masks(p, q, m, crlf, lines, max, n);
+		if (*n == max)
+			return p;
+		q += 64;
+	}
+
+	int k = 0;
+	p = v_scan_scalar(p, end, last, lines + *n, max - *n, &k);
+	*n += k;
+
+	return p;
+}
+#endif	/* V_SCAN_X86 */
+
+static void v_scan_pick(void)
+{
+	v_scan_impl = v_scan_scalar;
+
+#ifdef V_SCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		v_scan_impl = v_scan_sse2;
+	if (__builtin_cpu_supports("avx2"))
+		v_scan_impl = v_scan_avx2;
+#endif
+}
+
+/**
+ * v_scan_use - force the flavour of the line scanner
+ * name: Either "scalar", "sse2" or "avx2".
+ *
+ * Force the flavour of the line scanner used by v_scan_lines() instead of the
+ * widest one the running processor supports. Every flavour gives the exact
+ * same lines, so this is only of use to compare them against each other.
+ *
+ * Returns V_OK on success, V_ERR if the flavour is unknown or unsupported.
+ */
+int v_scan_use(const char *name)
+{
+	if (!name)
+		return V_ERR;
+
+	pthread_once(&v_scan_once, v_scan_pick);
+
+	if (!strcmp(name, "scalar")) {
+		v_scan_impl = v_scan_scalar;
+		return V_OK;
+	}
+
+#ifdef V_SCAN_X86
+	if (!strcmp(name, "sse2") && __builtin_cpu_supports("sse2")) {
+		v_scan_impl = v_scan_sse2;
+		return V_OK;
+	}
+
+	if (!strcmp(name, "avx2") && __builtin_cpu_supports("avx2")) {
+		v_scan_impl = v_scan_avx2;
+		return V_OK;
+	}
+#endif
+
+	return V_ERR;
+}
+
+/**
+ * v_scan_lines - split a block of text into lines
+ * p: Start of the block.
+ * end: End of the block.
+ * last: Whether the block ends the file.
+ * lines: Where the lines found will be saved.
+ * max: Maximum number of lines to be saved inside lines.
+ * n: Pointer to where the number of lines found will be saved.
+ *
+ * Split a block of text into lines, up to max of them. Line terminators are
+ * left out of the lines, be it a "\n" or a "\r\n", both being recognized in
+ * the same pass over the block. A line running past the end of the block is
+ * left alone unless last is true, so that the caller can carry it over to its
+ * next block. The lines point inside the block, nothing is copied.
+ *
+ * Returns the address of the first byte not consumed, end once done.
+ */
+char *v_scan_lines(char *p, char *end, bool last, struct v_line *lines,
+		   int max, int *n)
+{
+	pthread_once(&v_scan_once, v_scan_pick);
+
+	return v_scan_impl(p, end, last, lines, max, n);
+}
+
+static void *v_index_run(void *arg)
+{
+	struct v_chunk *c = arg;
+	char *p = c->p;
+
+	while (p < c->end) {
+		if (c->n == c->cap) {
+			size_t cap = c->cap ? c->cap * 2 : V_LOAD_BATCH;
+			struct v_line *tmp = realloc(c->lines,
+						     sizeof(struct v_line) * cap);
+			if (!tmp) {
+				c->err = true;
+				break;
+			}
+			c->lines = tmp;
+			c->cap = cap;
+		}
+
+		size_t room = c->cap - c->n;
+		int k = 0;
+		char *next = v_scan_lines(p, c->end, c->last, c->lines + c->n,
+					  room > INT_MAX ? INT_MAX : room, &k);
+		if (!k)
+			break;
+
+		c->n += k;
+		p = next;
+	}
+
+	c->next = p;
+
+	return NULL;
+}
+
+static int v_index_feed(struct v_chunk *c,
+			int (*fn)(void *arg, struct v_line *lines, int n),
+			void *arg)
+{
+	for (size_t i = 0; i < c->n; ) {
+		size_t left = c->n - i;
+		int k = left > INT_MAX ? INT_MAX : left;
+
+		if (fn(arg, c->lines + i, k) == V_ERR)
+			return V_ERR;
+		i += k;
+	}
+
+	return V_OK;
+}
+
+static char *v_index_seq(char *p, char *end, bool last,
+			 int (*fn)(void *arg, struct v_line *lines, int n),
+			 void *arg)
+{
+	struct v_line lines[V_LEAF_MAX];
+	int n = 0;
+
+	while (p < end) {
+		char *next = v_scan_lines(p, end, last, lines, V_LEAF_MAX, &n);
+		if (!n)
+			break;
+
+		if (fn(arg, lines, n) == V_ERR)
+			return NULL;
+		p = next;
+	}
+
+	return p;
+}
+
+static char *v_index_round(char *p, char *end, bool last, int threads,
+			   int (*fn)(void *arg, struct v_line *lines, int n),
+			   void *arg)
+{
+	size_t len = end - p;
+	size_t k = (len + V_INDEX_BLK - 1) / V_INDEX_BLK;
+	if (k > (size_t)threads)
+		k = threads;
+	if (k < 2)
+		return v_index_seq(p, end, last, fn, arg);
+
+	/* A line belongs to the chunk it starts in */
+	struct v_chunk chunks[V_THREADS_MAX];
+	char *from = p;
+	for (size_t i = 0; i < k; i++) {
+		struct v_chunk *c = &chunks[i];
+		char *to = end;
+
+		char *cut = p + len / k * (i + 1);
+		if (i + 1 < k && cut <= from) {
+			to = from;
+		} else if (i + 1 < k) {
+			char *nl = memchr(cut - 1, '\n', end - cut + 1);
+			to = nl ? nl + 1 : end;
+		}
+
+		memset(c, 0, sizeof(struct v_chunk));
+		c->p = from;
+		c->end = to;
+		c->last = to == end ? last : true;
+		c->next = from;
+		c->started = !pthread_create(&c->tid, NULL, v_index_run, c);
+		if (!c->started)
+			v_index_run(c);
+		from = to;
+	}
+
+	/* Hand the lines over in order while the later chunks are scanned */
+	char *next = p;
+	bool err = false;
+	for (size_t i = 0; i < k; i++) {
+		struct v_chunk *c = &chunks[i];
+
+		if (c->started)
+			pthread_join(c->tid, NULL);
+		if (c->err || (!err && v_index_feed(c, fn, arg) == V_ERR))
+			err = true;
+		if (c->p < c->end)
+			next = c->next;
+		free(c->lines);
+	}
+
+	return err ? NULL : next;
+}
+
+/**
+ * v_index_lines - split a block of text into lines using several threads
+ * p: Start of the block.
+ * end: End of the block.
+ * last: Whether the block ends the file.
+ * threads: Maximum number of threads to be used.
+ * fn: Function the lines found are handed to, in order.
+ * arg: First argument passed to fn.
+ *
+ * Split a block of text into lines just like v_scan_lines() does, except the
+ * block can be of any size and every line found is handed to fn. The block is
+ * gone through in rounds of up to threads * V_INDEX_BLK bytes, each of them
+ * being cut into chunks scanned by threads of their own. A chunk starts right
+ * after a '\n', so the lines straddling two chunks go to the first one and
+ * the lines handed to fn are the exact same ones a single thread would find.
+ * Blocks smaller than V_INDEX_BLK are scanned without any extra thread. fn
+ * should return V_ERR to stop early.
+ *
+ * Returns the address of the first byte not consumed, NULL if fn returned
+ * V_ERR or the memory ran out.
+ */
+char *v_index_lines(char *p, char *end, bool last, int threads,
+		    int (*fn)(void *arg, struct v_line *lines, int n),
+		    void *arg)
+{
+	if (!p || !end || !fn)
+		return NULL;
+
+	if (threads < 1)
+		threads = 1;
+	if (threads > V_THREADS_MAX)
+		threads = V_THREADS_MAX;
+
+	size_t step = (size_t)threads * V_INDEX_BLK;
+	while (p < end) {
+		char *stop = (size_t)(end - p) > step ? p + step : end;
+		char *next = v_index_round(p, stop, stop == end && last,
+					   threads, fn, arg);
+		if (!next)
+			return NULL;
+		if (next == p && stop == end)
+			break;
+
+		/* A line longer than the whole round, look further */
+		step = next == p ? step * 2 : (size_t)threads * V_INDEX_BLK;
+		p = next;
+	}
+
+	return p;
+}
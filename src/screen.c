@@ -0,0 +1,524 @@
+/*
+ * screen.c - Raw escape sequence screen routines
+ *
+ * This file provides a screen backend which talks to the terminal through
+ * escape sequences of its own instead of going through curses. Drawing only
+ * fills a back buffer of character cells, and each frame is sent by comparing
+ * it against a front buffer holding what the terminal already shows: only
+ * the cells which differ get written, the cursor being moved between them
+ * with the shortest sequence available. A whole frame is sent with a single
+ * write(), wrapped into a synchronized update for the terminal to show it all
+ * at once. Curses is still in charge of the terminal modes and the keyboard.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <ncurses.h>
+
+#include <void.h>
+
+static const struct v_cell v_scr_blank = {' ', V_SCR_NORMAL};
+
+static bool v_scr_same(const struct v_cell *a, const struct v_cell *b)
+{
+	return a->ch == b->ch && a->attr == b->attr;
+}
+
+static void v_scr_fill(struct v_cell *cell, int n)
+{
+	for (int i = 0; i < n; i++)
+		cell[i] = v_scr_blank;
+}
+
+static int v_scr_emit(struct v_screen *scr, const char *s, size_t len)
+{
+	if (scr->len + len > scr->cap) {
+		size_t cap = scr->cap ? scr->cap : V_SCR_OUT;
+		while (cap < scr->len + len)
+			cap *= 2;
+
+		char *tmp = realloc(scr->out, cap);
+		if (!tmp)
+			return V_ERR;
+		scr->out = tmp;
+		scr->cap = cap;
+	}
+
+	memcpy(scr->out + scr->len, s, len);
+	scr->len += len;
+
+	return V_OK;
+}
+
+/* Starts the synchronized update once the frame changes something */
+static void v_scr_open(struct v_screen *scr)
+{
+	if (scr->open)
+		return;
+
+	v_scr_emit(scr, V_ESC_SYNC_ON, strlen(V_ESC_SYNC_ON));
+	scr->open = true;
+}
+
+static void v_scr_sgr(struct v_screen *scr, int attr)
+{
+	if (scr->cattr == attr)
+		return;
+
+	char buf[V_SCR_SEQ];
+	int len = attr == V_SCR_BAR ?
+		  snprintf(buf, sizeof(buf), "\033[0;3%d;4%dm", V_BAR_FG,
+			   V_BAR_BG) :
+		  snprintf(buf, sizeof(buf), "\033[m");
+	v_scr_emit(scr, buf, len);
+	scr->cattr = attr;
+}
+
+static void v_scr_goto(struct v_screen *scr, int y, int x)
+{
+	if (scr->cy == y && scr->cx == x)
+		return;
+
+	char best[V_SCR_SEQ], buf[V_SCR_SEQ];
+	int len = 0;
+	if (!y && !x)
+		len = snprintf(best, sizeof(best), "\033[H");
+	else if (!x)
+		len = snprintf(best, sizeof(best), "\033[%dH", y + 1);
+	else
+		len = snprintf(best, sizeof(best), "\033[%d;%dH", y + 1,
+			       x + 1);
+
+	/* Relative moves only work from a known position */
+	int n = 0;
+	if (scr->cy == y && scr->cx != -1 && !x)
+		n = snprintf(buf, sizeof(buf), "\r");
+	else if (scr->cy == y && scr->cx != -1 && x > scr->cx)
+		n = snprintf(buf, sizeof(buf), "\033[%dC", x - scr->cx);
+	else if (scr->cy == y && scr->cx != -1)
+		n = snprintf(buf, sizeof(buf), "\033[%dD", scr->cx - x);
+	else if (scr->cy == y - 1 && scr->cx != -1 && !x)
+		n = snprintf(buf, sizeof(buf), "\r\n");
+	else if (scr->cx == x && scr->cy != -1 && y > scr->cy)
+		n = snprintf(buf, sizeof(buf), "\033[%dB", y - scr->cy);
+	else if (scr->cx == x && scr->cy != -1)
+		n = snprintf(buf, sizeof(buf), "\033[%dA", scr->cy - y);
+
+	if (n && n < len)
+		v_scr_emit(scr, buf, n);
+	else
+		v_scr_emit(scr, best, len);
+
+	scr->cy = y;
+	scr->cx = x;
+}
+
+/* Number of blank cells with the same attributes from x on, up to end */
+static int v_scr_blanks(const struct v_cell *line, int x, int end)
+{
+	int i = x;
+	while (i < end && line[i].ch == ' ' && line[i].attr == line[x].attr)
+		i++;
+
+	return i - x;
+}
+
+/* Sends the cells of line y from x to end, which is past the last change */
+static void v_scr_run(struct v_screen *scr, int y, int x, int end)
+{
+	struct v_cell *b = &scr->back[y * scr->cols];
+	struct v_cell *f = &scr->front[y * scr->cols];
+
+	v_scr_goto(scr, y, x);
+	for (int i = x; i < end; i++) {
+		v_scr_sgr(scr, b[i].attr);
+		v_scr_emit(scr, &b[i].ch, 1);
+		f[i] = b[i];
+	}
+
+	/* Past the last column, the terminal may or may not have wrapped */
+	scr->cx = end < scr->cols ? end : -1;
+}
+
+static void v_scr_line(struct v_screen *scr, int y)
+{
+	struct v_cell *b = &scr->back[y * scr->cols];
+	struct v_cell *f = &scr->front[y * scr->cols];
+
+	/* Writing the bottom right cell may scroll the whole screen */
+	int cols = y == scr->rows - 1 ? scr->cols - 1 : scr->cols;
+
+	int x = 0;
+	while (x < cols) {
+		if (v_scr_same(&b[x], &f[x])) {
+			x++;
+			continue;
+		}
+
+		/* A blank end of line is erased rather than written */
+		int blank = x;
+		while (blank < scr->cols &&
+		       v_scr_same(&b[blank], &v_scr_blank))
+			blank++;
+		if (blank == scr->cols) {
+			v_scr_goto(scr, y, x);
+			v_scr_sgr(scr, V_SCR_NORMAL);
+			v_scr_emit(scr, V_ESC_EL, strlen(V_ESC_EL));
+			v_scr_fill(&f[x], scr->cols - x);
+			return;
+		}
+
+		/* So is a long run of blanks, with the attributes it has */
+		int run = v_scr_blanks(b, x, cols);
+		if (run >= V_SCR_ECH) {
+			char buf[V_SCR_SEQ];
+			v_scr_goto(scr, y, x);
+			v_scr_sgr(scr, b[x].attr);
+			v_scr_emit(scr, buf, snprintf(buf, sizeof(buf),
+						      "\033[%dX", run));
+			memcpy(&f[x], &b[x], sizeof(struct v_cell) * run);
+			x += run;
+			continue;
+		}
+
+		/* Cells left alone in between cost less written than skipped */
+		int last = x;
+		for (int i = x + 1; i < cols && i - last <= V_SCR_GAP; i++) {
+			if (v_scr_same(&b[i], &f[i]))
+				continue;
+			if (v_scr_blanks(b, i, cols) >= V_SCR_ECH)
+				break;
+			last = i;
+		}
+
+		v_scr_run(scr, y, x, last + 1);
+		x = last + 1;
+	}
+}
+
+static int v_scr_write(struct v_screen *scr)
+{
+	char *p = scr->out;
+	size_t len = scr->len;
+
+	scr->len = 0;
+	while (len) {
+		ssize_t n = write(scr->fd, p, len);
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1)
+			return V_ERR;
+		p += n;
+		len -= n;
+		scr->bytes += n;
+	}
+
+	return V_OK;
+}
+
+/**
+ * v_scr_new - create a raw escape sequence screen
+ * fd: File descriptor of the terminal to draw on.
+ *
+ * Create a raw escape sequence screen drawing on the terminal found on fd. The
+ * screen has no size yet: v_scr_resize() must be called before drawing on it.
+ * It must be released with v_scr_free().
+ *
+ * Returns a pointer to the new v_screen struct on success, NULL otherwise.
+ */
+struct v_screen *v_scr_new(int fd)
+{
+	struct v_screen *scr = calloc(1, sizeof(struct v_screen));
+	if (!scr)
+		return NULL;
+
+	scr->fd = fd;
+	scr->cy = -1;
+	scr->cx = -1;
+
+	return scr;
+}
+
+/**
+ * v_scr_resize - set the size of a raw escape sequence screen
+ * scr: Pointer to the targeted v_screen struct.
+ * rows: Number of lines of the terminal.
+ * cols: Number of columns of the terminal.
+ *
+ * Set the size of a raw escape sequence screen to the size of its terminal.
+ * Both buffers are blanked and the terminal gets cleared by the next frame,
+ * so everything has to be drawn again.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_scr_resize(struct v_screen *scr, int rows, int cols)
+{
+	if (!scr || rows < 0 || cols < 0)
+		return V_ERR;
+
+	size_t n = (size_t)rows * cols;
+	struct v_cell *front = malloc(sizeof(struct v_cell) * (n ? n : 1));
+	struct v_cell *back = malloc(sizeof(struct v_cell) * (n ? n : 1));
+	if (!front || !back) {
+		free(front);
+		free(back);
+		return V_ERR;
+	}
+
+	free(scr->front);
+	free(scr->back);
+	scr->front = front;
+	scr->back = back;
+	scr->rows = rows;
+	scr->cols = cols;
+	v_scr_fill(scr->back, n);
+
+	return v_scr_invalidate(scr);
+}
+
+/**
+ * v_scr_invalidate - forget what the terminal of a screen shows
+ * scr: Pointer to the targeted v_screen struct.
+ *
+ * Forget what the terminal of a raw escape sequence screen shows, for the next
+ * frame to clear it and send every cell of the back buffer over again. The
+ * back buffer is left as it is.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_scr_invalidate(struct v_screen *scr)
+{
+	if (!scr)
+		return V_ERR;
+
+	v_scr_open(scr);
+	v_scr_emit(scr, V_ESC_CLEAR, strlen(V_ESC_CLEAR));
+	v_scr_fill(scr->front, scr->rows * scr->cols);
+	scr->cattr = V_SCR_NORMAL;
+	scr->cy = 0;
+	scr->cx = 0;
+
+	return V_OK;
+}
+
+/**
+ * v_scr_move - move where a screen gets drawn on next
+ * scr: Pointer to the targeted v_screen struct.
+ * y: Line to be drawn on next.
+ * x: Column to be drawn on next.
+ *
+ * Move where the next cells get drawn into the back buffer of a raw escape
+ * sequence screen. Nothing is sent to the terminal.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_scr_move(struct v_screen *scr, int y, int x)
+{
+	if (!scr || y < 0 || y >= scr->rows || x < 0)
+		return V_ERR;
+
+	scr->y = y;
+	scr->x = x;
+
+	return V_OK;
+}
+
+/**
+ * v_scr_attr - set the attributes of the cells a screen gets drawn with
+ * scr: Pointer to the targeted v_screen struct.
+ * attr: The attributes, one of the V_SCR_* values.
+ *
+ * Set the attributes the next cells drawn into the back buffer of a raw
+ * escape sequence screen get.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_scr_attr(struct v_screen *scr, int attr)
+{
+	if (!scr)
+		return V_ERR;
+
+	scr->attr = attr;
+
+	return V_OK;
+}
+
+/**
+ * v_scr_put - draw a string on a screen
+ * scr: Pointer to the targeted v_screen struct.
+ * s: The string to be drawn.
+ * len: Length of string s.
+ *
+ * Draw a string into the back buffer of a raw escape sequence screen, one cell
+ * per char, from where v_scr_move() left off. The string is cut short at the
+ * right edge of the screen. Chars which can't be shown as they are, control
+ * chars and bytes outside of ASCII, are drawn as '?'.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_scr_put(struct v_screen *scr, const char *s, int len)
+{
+	if (!scr || (!s && len))
+		return V_ERR;
+
+	struct v_cell *cell = &scr->back[scr->y * scr->cols];
+	for (int i = 0; i < len && scr->x < scr->cols; i++) {
+		unsigned char c = s[i];
+		cell[scr->x].ch = c >= ' ' && c < 127 ? c : '?';
+		cell[scr->x].attr = scr->attr;
+		scr->x++;
+	}
+
+	return V_OK;
+}
+
+/**
+ * v_scr_clrtoeol - blank a screen line up to its end
+ * scr: Pointer to the targeted v_screen struct.
+ *
+ * Blank the back buffer of a raw escape sequence screen from where
+ * v_scr_move() left off up to the end of the line.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_scr_clrtoeol(struct v_screen *scr)
+{
+	if (!scr)
+		return V_ERR;
+
+	if (scr->x < scr->cols)
+		v_scr_fill(&scr->back[scr->y * scr->cols + scr->x],
+			   scr->cols - scr->x);
+
+	return V_OK;
+}
+
+/**
+ * v_scr_scroll - scroll some lines of a screen
+ * scr: Pointer to the targeted v_screen struct.
+ * top: First line of the scrolled lines.
+ * bot: Last line of the scrolled lines.
+ * n: Number of lines to scroll by, upward when positive.
+ *
+ * Scroll the lines from top to bot of a raw escape sequence screen by n lines,
+ * like scrl() does. The terminal is told to scroll them within a scrolling
+ * region, and both buffers are scrolled along, so that only the lines scrolled
+ * into sight are left to be drawn. Those come in blank.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_scr_scroll(struct v_screen *scr, int top, int bot, int n)
+{
+	if (!scr || top < 0 || bot >= scr->rows || top > bot)
+		return V_ERR;
+
+	int lines = bot - top + 1;
+	int k = abs(n);
+	if (!n || k >= lines)
+		return V_ERR;
+
+	/* Lines scrolled in are blanked with the current background */
+	char buf[V_SCR_SEQ];
+	v_scr_open(scr);
+	v_scr_sgr(scr, V_SCR_NORMAL);
+	int len = snprintf(buf, sizeof(buf), "\033[%d;%dr\033[%d%c\033[r",
+			   top + 1, bot + 1, k, n > 0 ? 'S' : 'T');
+	v_scr_emit(scr, buf, len);
+
+	/* Setting the scrolling region sends the cursor home */
+	scr->cy = 0;
+	scr->cx = 0;
+
+	size_t cols = scr->cols;
+	struct v_cell *bufs[] = {scr->front, scr->back};
+	for (int i = 0; i < 2; i++) {
+		struct v_cell *p = &bufs[i][top * cols];
+		if (n > 0) {
+			memmove(p, p + k * cols,
+				sizeof(struct v_cell) * (lines - k) * cols);
+			v_scr_fill(p + (lines - k) * cols, k * cols);
+		} else {
+			memmove(p + k * cols, p,
+				sizeof(struct v_cell) * (lines - k) * cols);
+			v_scr_fill(p, k * cols);
+		}
+	}
+
+	return V_OK;
+}
+
+/**
+ * v_scr_flush - send a frame to the terminal of a screen
+ * scr: Pointer to the targeted v_screen struct.
+ * y: Line to leave the terminal cursor at.
+ * x: Column to leave the terminal cursor at.
+ *
+ * Send the cells of the back buffer of a raw escape sequence screen which
+ * differ from what the terminal shows, then leave the cursor at the given
+ * position. A frame which changes any cell is wrapped into a synchronized
+ * update, while a frame which only moves the cursor sends nothing else. Every
+ * escape sequence of the frame goes out with a single write().
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_scr_flush(struct v_screen *scr, int y, int x)
+{
+	if (!scr)
+		return V_ERR;
+
+	for (int i = 0; i < scr->rows; i++) {
+		struct v_cell *b = &scr->back[i * scr->cols];
+		struct v_cell *f = &scr->front[i * scr->cols];
+
+		/* v_scr_line() never writes the bottom right cell, skip it */
+		int cols = i == scr->rows - 1 ? scr->cols - 1 : scr->cols;
+		if (memcmp(b, f, sizeof(struct v_cell) * cols)) {
+			v_scr_open(scr);
+			v_scr_line(scr, i);
+		}
+	}
+
+	if (y >= 0 && y < scr->rows && x >= 0 && x < scr->cols)
+		v_scr_goto(scr, y, x);
+
+	if (scr->open)
+		v_scr_emit(scr, V_ESC_SYNC_OFF, strlen(V_ESC_SYNC_OFF));
+	scr->open = false;
+
+	return v_scr_write(scr);
+}
+
+/**
+ * v_scr_free - release a raw escape sequence screen
+ * scr: Pointer to the targeted v_screen struct.
+ *
+ * Release a raw escape sequence screen along with its buffers. The terminal is
+ * left with its attributes reset.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_scr_free(struct v_screen *scr)
+{
+	if (!scr)
+		return V_ERR;
+
+	v_scr_sgr(scr, V_SCR_NORMAL);
+	v_scr_write(scr);
+	free(scr->out);
+	free(scr->front);
+	free(scr->back);
+	free(scr);
+
+	return V_OK;
+}
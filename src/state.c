@@ -15,6 +15,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <void.h>
 
@@ -32,7 +33,10 @@ struct v_state *v_new_state(void)
 	if (!v)
 		return NULL;
 
-	v->rows = NULL;
+	v->root = NULL;
+	v->height = 0;
+	v->rc_leaf = NULL;
+	v->rc_base = 0;
 	v->nrows = 0;
 	v->scr_x = 0;
 	v->scr_y = 0;
@@ -47,6 +51,32 @@ struct v_state *v_new_state(void)
 	v->dirty = false;
 	v->mode = V_CMD;
 	v->run = true;
+	v->pt = false;
+	v->mm = false;
+	v->src = NULL;
+	v->src_len = 0;
+	v->add = NULL;
+	v->arena = NULL;
+	v->ld = NULL;
+	v->sv = NULL;
+	v->jr = NULL;
+	v->sync = V_SYNC_FULL;
+	v->view = false;
+	v->budget = (size_t)V_PAGE_BUDGET << 20;
+	v->pg = NULL;
+	v->follow = false;
+	v->fw = NULL;
+	v->batch = V_KEY_BATCH;
+	v->vt = false;
+	v->scr = NULL;
+
+	/* Nothing was drawn yet */
+	memset(&v->dmg, 0, sizeof(v->dmg));
+	v->dmg.all = true;
+
+	/* Index the lines of large files on every core by default */
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	v->threads = cpus < 1 ? 1 : cpus > V_THREADS_MAX ? V_THREADS_MAX : cpus;
 
 	return v;
 }
@@ -68,6 +98,8 @@ int v_dstr_state(struct v_state *v)
 
 	v_reset_term(v);
 	v_free_rows(v);
+	v_jrnl_close(v);
+	free(v->dmg.lines);
 	memset(v->stats_msg, 0, sizeof(v->stats_msg));
 	free(v->filename);
 	v->filename = NULL;
@@ -13,7 +13,9 @@
  * It is licensed under MIT License. See the LICENSE file for details.
  */
 
+#include <stdio.h>
 #include <signal.h>
+#include <unistd.h>
 #include <ncurses.h>
 #include <stdbool.h>
 
@@ -31,8 +33,11 @@ static void v_handle_winch(int sig)
  * v_init_term - initialize the specifed v_state terminal into curses mode
  * v: Pointer to the targeted v_state struct.
  *
- * Initialize the specified v_state terminal into curses mode. Don't forget to
- * call v_reset_term() before exiting the program.
+ * Initialize the specified v_state terminal into curses mode. Bracketed paste
+ * is turned on as well, so that pasted text can be told apart from typed keys
+ * and inserted in one go. When v->vt is set, the screen is then drawn on with
+ * raw escape sequences rather than through curses. Don't forget to call
+ * v_reset_term() before exiting the program.
  *
  * Returns V_OK on success, otherwise V_ERR.
  */
@@ -46,6 +51,24 @@ int v_init_term(struct v_state *v)
 	keypad(stdscr, TRUE);
 	noecho();
 	set_escdelay(0);
+	idlok(stdscr, TRUE);
+
+	/* Pasted text comes wrapped, to be told apart from typed keys */
+	define_key(V_PASTE_BEGIN, V_KEY_PASTE);
+	define_key(V_PASTE_END, V_KEY_PASTE_END);
+	putp(V_PASTE_ON);
+	fflush(stdout);
+
+	/*
+	 * Curses keeps the terminal modes and the keys, but is done drawing
+	 * for good: getch() won't repaint a screen it never touches again.
+	 */
+	if (v->vt) {
+		refresh();
+		v->scr = v_scr_new(STDOUT_FILENO);
+		if (!v->scr)
+			v->vt = false;
+	}
 
 	getmaxyx(stdscr, v->scr_y, v->scr_x);
 	v->scr_y -= 2;
@@ -88,8 +111,8 @@ error:
  *
  * Reset the specified v_state terminal back into cooked mode. This function
  * should be called before exiting the program if v_init_term() is called
- * previously. All of the attributes related to the curses mode in the specified
- * v_state struct will erased.
+ * previously. Bracketed paste is turned back off. All of the attributes related
+ * to the curses mode in the specified v_state struct will erased.
  *
  * Returns V_OK on success, V_ERR otherwise.
  */
@@ -98,6 +121,14 @@ int v_reset_term(struct v_state *v)
 	if (!v)
 		return V_ERR;
 
+	v_scr_free(v->scr);
+	v->scr = NULL;
+
+	/* Arguments like -h exit before curses ever takes the terminal */
+	if (stdscr) {
+		putp(V_PASTE_OFF);
+		fflush(stdout);
+	}
 	endwin();
 	v->colors = false;
 	v->scr_x = 0;
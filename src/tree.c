@@ -0,0 +1,544 @@
+/*
+ * tree.c - Counted B+tree of v_row structs
+ *
+ * This file provides the container holding every v_row of a buffer. Rows live
+ * in fixed-size v_leaf blocks which are chained together in order, and v_node
+ * internal nodes keep the number of rows found under each of their children.
+ * Inserting or deleting a row therefore only shifts the rows of a single leaf
+ * and updates the counts on the path down to it, while finding a row by its
+ * line number walks down the counts. The last leaf looked up is cached inside
+ * the v_state struct, which turns the usual in-order accesses (drawing the
+ * screen, saving, moving the cursor around) into constant time lookups.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <void.h>
+
+/**
+ * struct v_path - represent a step taken while walking down the tree
+ * node: The internal node walked through.
+ * i: Index of the child taken inside node.
+ */
+struct v_path {
+	struct v_node *node;
+	int i;
+};
+
+static int v_tree_sum(struct v_node *node)
+{
+	int sum = 0;
+	for (int i = 0; i < node->n; i++)
+		sum += node->cnt[i];
+
+	return sum;
+}
+
+/*
+ * Allocate the nodes v_tree_add_kid() splits into when adding a child at depth
+ * d: one per full node walked up from there, plus a new root if they all are.
+ * Nothing can fail anymore once the tree starts being modified.
+ */
+static int v_tree_spare(struct v_path *path, int d, struct v_node **spare)
+{
+	int n = 0;
+	while (n <= d && path[d - n].node->n == V_NODE_MAX)
+		n++;
+	if (n > d)
+		n++;
+
+	for (int i = 0; i < n; i++) {
+		spare[i] = calloc(1, sizeof(struct v_node));
+		if (spare[i])
+			continue;
+
+		while (i--)
+			free(spare[i]);
+		return V_ERR;
+	}
+
+	return V_OK;
+}
+
+static void v_tree_add_kid(struct v_state *v, struct v_path *path, int d,
+			   int left, void *kid, int cnt, struct v_node **spare)
+{
+	struct v_node *node = path[d].node;
+	int i = path[d].i + 1;
+
+	node->cnt[i - 1] = left;
+	if (node->n < V_NODE_MAX) {
+		memmove(&node->kid[i + 1], &node->kid[i],
+			sizeof(void *) * (node->n - i));
+		memmove(&node->cnt[i + 1], &node->cnt[i],
+			sizeof(int) * (node->n - i));
+		node->kid[i] = kid;
+		node->cnt[i] = cnt;
+		node->n++;
+		return;
+	}
+
+	struct v_node *right = spare[0];
+	int half = V_NODE_MAX / 2;
+	right->n = node->n - half;
+	memcpy(right->kid, &node->kid[half], sizeof(void *) * right->n);
+	memcpy(right->cnt, &node->cnt[half], sizeof(int) * right->n);
+	node->n = half;
+
+	struct v_node *dst = i <= half ? node : right;
+	int j = i <= half ? i : i - half;
+	memmove(&dst->kid[j + 1], &dst->kid[j], sizeof(void *) * (dst->n - j));
+	memmove(&dst->cnt[j + 1], &dst->cnt[j], sizeof(int) * (dst->n - j));
+	dst->kid[j] = kid;
+	dst->cnt[j] = cnt;
+	dst->n++;
+
+	if (d > 0) {
+		v_tree_add_kid(v, path, d - 1, v_tree_sum(node), right,
+			       v_tree_sum(right), spare + 1);
+		return;
+	}
+
+	struct v_node *root = spare[1];
+	root->kid[0] = node;
+	root->cnt[0] = v_tree_sum(node);
+	root->kid[1] = right;
+	root->cnt[1] = v_tree_sum(right);
+	root->n = 2;
+	v->root = root;
+	v->height++;
+}
+
+static void v_tree_del_kid(struct v_state *v, struct v_path *path, int d)
+{
+	struct v_node *node = path[d].node;
+	int i = path[d].i;
+
+	memmove(&node->kid[i], &node->kid[i + 1],
+		sizeof(void *) * (node->n - i - 1));
+	memmove(&node->cnt[i], &node->cnt[i + 1],
+		sizeof(int) * (node->n - i - 1));
+	node->n--;
+	if (node->n)
+		return;
+
+	free(node);
+	if (d > 0) {
+		v_tree_del_kid(v, path, d - 1);
+		return;
+	}
+
+	v->root = NULL;
+	v->height = 0;
+}
+
+static void v_tree_unlink_leaf(struct v_leaf *leaf)
+{
+	if (leaf->prev)
+		leaf->prev->next = leaf->next;
+	if (leaf->next)
+		leaf->next->prev = leaf->prev;
+	free(leaf);
+}
+
+static struct v_leaf *v_tree_walk(struct v_state *v, int y, bool ins,
+				  struct v_path *path, int *pos)
+{
+	struct v_node *node = v->root;
+	int rem = y;
+
+	for (int d = 0; d < v->height; d++) {
+		int i = 0;
+		while (i < node->n - 1 &&
+		       (ins ? rem > node->cnt[i] : rem >= node->cnt[i]))
+			rem -= node->cnt[i++];
+
+		path[d].node = node;
+		path[d].i = i;
+		node = node->kid[i];
+	}
+
+	*pos = rem;
+
+	return (struct v_leaf *)node;
+}
+
+static int v_tree_root(struct v_state *v)
+{
+	struct v_node *root = calloc(1, sizeof(struct v_node));
+	struct v_leaf *first = calloc(1, sizeof(struct v_leaf));
+	if (!root || !first) {
+		free(root);
+		free(first);
+		return V_ERR;
+	}
+
+	root->kid[0] = first;
+	root->n = 1;
+	v->root = root;
+	v->height = 1;
+
+	return V_OK;
+}
+
+/* Moves the rows of a leaf from pos on into a new leaf right after it */
+static int v_tree_cut(struct v_state *v, struct v_path *path,
+		      struct v_leaf *leaf, int pos)
+{
+	struct v_node *spare[V_TREE_DEPTH + 1];
+	struct v_leaf *right = calloc(1, sizeof(struct v_leaf));
+	if (!right)
+		return V_ERR;
+	if (v_tree_spare(path, v->height - 1, spare) == V_ERR) {
+		free(right);
+		return V_ERR;
+	}
+
+	right->n = leaf->n - pos;
+	memcpy(right->rows, &leaf->rows[pos], sizeof(struct v_row) * right->n);
+	leaf->n = pos;
+
+	right->prev = leaf;
+	right->next = leaf->next;
+	if (leaf->next)
+		leaf->next->prev = right;
+	leaf->next = right;
+	v->rc_leaf = NULL;
+
+	v_tree_add_kid(v, path, v->height - 1, leaf->n, right, right->n, spare);
+
+	return V_OK;
+}
+
+/* Puts rows at line y, which must be found at the end of a leaf */
+static int v_tree_put(struct v_state *v, int y, struct v_row *rows, int n)
+{
+	while (n > 0) {
+		struct v_path path[V_TREE_DEPTH];
+		int pos = 0;
+		struct v_leaf *leaf = v_tree_walk(v, y, true, path, &pos);
+
+		int k = V_LEAF_MAX - leaf->n;
+		if (k > n)
+			k = n;
+
+		if (k > 0) {
+			memcpy(&leaf->rows[leaf->n], rows,
+			       sizeof(struct v_row) * k);
+			leaf->n += k;
+			for (int d = 0; d < v->height; d++)
+				path[d].node->cnt[path[d].i] += k;
+			goto next;
+		}
+
+		struct v_node *spare[V_TREE_DEPTH + 1];
+		struct v_leaf *right = calloc(1, sizeof(struct v_leaf));
+		if (!right)
+			return V_ERR;
+		if (v_tree_spare(path, v->height - 1, spare) == V_ERR) {
+			free(right);
+			return V_ERR;
+		}
+
+		k = n < V_LEAF_MAX ? n : V_LEAF_MAX;
+		memcpy(right->rows, rows, sizeof(struct v_row) * k);
+		right->n = k;
+		right->prev = leaf;
+		right->next = leaf->next;
+		if (leaf->next)
+			leaf->next->prev = right;
+		leaf->next = right;
+
+		/* v_tree_add_kid() only updates the parent of the new leaf */
+		for (int d = 0; d < v->height - 1; d++)
+			path[d].node->cnt[path[d].i] += k;
+		v_tree_add_kid(v, path, v->height - 1, leaf->n, right, k,
+			       spare);
+
+next:
+		v->nrows += k;
+		y += k;
+		rows += k;
+		n -= k;
+	}
+
+	return v->nrows;
+}
+
+/**
+ * v_row_at - get the v_row struct of a given line
+ * v: Pointer to the targeted v_state struct.
+ * y: The line number, starting from 0.
+ *
+ * Get the v_row struct of a given line. The returned pointer is only valid
+ * until the next row insertion or deletion, since rows are moved around inside
+ * their leaf. Looking up the same leaf as the previous call, or one of its
+ * neighbours, takes constant time. Any other line is found in logarithmic
+ * time.
+ *
+ * Returns a pointer to the v_row struct on success, NULL if there is no line y.
+ */
+struct v_row *v_row_at(struct v_state *v, int y)
+{
+	if (!v || y < 0 || y >= v->nrows)
+		return NULL;
+
+	if (v->pg)
+		return v_page_row(v, y);
+
+	struct v_leaf *leaf = v->rc_leaf;
+	if (leaf && y >= v->rc_base + leaf->n && leaf->next &&
+	    y < v->rc_base + leaf->n + leaf->next->n) {
+		v->rc_base += leaf->n;
+		v->rc_leaf = leaf = leaf->next;
+	} else if (leaf && y < v->rc_base && leaf->prev &&
+		   y >= v->rc_base - leaf->prev->n) {
+		v->rc_leaf = leaf = leaf->prev;
+		v->rc_base -= leaf->n;
+	}
+
+	if (leaf && y >= v->rc_base && y < v->rc_base + leaf->n)
+		return &leaf->rows[y - v->rc_base];
+
+	struct v_path path[V_TREE_DEPTH];
+	int pos = 0;
+
+	leaf = v_tree_walk(v, y, false, path, &pos);
+	v->rc_leaf = leaf;
+	v->rc_base = y - pos;
+
+	return &leaf->rows[pos];
+}
+
+/**
+ * v_tree_insert - make room for a new row at a given line
+ * v: Pointer to the targeted v_state struct.
+ * y: The line number of the new row, from 0 up to v->nrows.
+ *
+ * Make room for a new row at a given line. Every row from line y onward is
+ * shifted down by one line and v->nrows is incremented. A full leaf is split in
+ * half beforehand, which may in turn split its ancestors. Everything the split
+ * needs is allocated up front, so the tree is left untouched on failure.
+ *
+ * Returns a pointer to the new zeroed v_row struct on success, NULL otherwise.
+ */
+struct v_row *v_tree_insert(struct v_state *v, int y)
+{
+	if (!v || y < 0 || y > v->nrows)
+		return NULL;
+
+	if (!v->root && v_tree_root(v) == V_ERR)
+		return NULL;
+
+	struct v_path path[V_TREE_DEPTH];
+	int pos = 0;
+	struct v_leaf *leaf = v_tree_walk(v, y, true, path, &pos);
+
+	if (leaf->n == V_LEAF_MAX) {
+		if (v_tree_cut(v, path, leaf, V_LEAF_MAX / 2) == V_ERR)
+			return NULL;
+
+		/* The path is stale now, simply walk down again */
+		return v_tree_insert(v, y);
+	}
+
+	memmove(&leaf->rows[pos + 1], &leaf->rows[pos],
+		sizeof(struct v_row) * (leaf->n - pos));
+	memset(&leaf->rows[pos], 0, sizeof(struct v_row));
+	leaf->n++;
+
+	for (int d = 0; d < v->height; d++)
+		path[d].node->cnt[path[d].i]++;
+
+	v_damage(v, y, -1);
+	v->nrows++;
+	v->rc_leaf = leaf;
+	v->rc_base = y - pos;
+
+	return &leaf->rows[pos];
+}
+
+/**
+ * v_tree_append - append a batch of rows at the end of the tree
+ * v: Pointer to the targeted v_state struct.
+ * rows: The v_row structs to be appended, in order.
+ * n: Number of v_row structs inside rows.
+ *
+ * Append a batch of rows at the end of the tree. The v_row structs are copied
+ * as they are, so the tree takes over whatever storage they refer to. The last
+ * leaf is topped up first, then brand new leaves are filled up completely and
+ * hooked to the right edge of the tree. Unlike repeated v_tree_insert() calls,
+ * no leaf is ever split, so the walk down the tree happens once per leaf
+ * rather than once per row and loaded leaves end up full instead of half full.
+ *
+ * Returns the newly updated number of v->nrows on success, V_ERR otherwise.
+ */
+int v_tree_append(struct v_state *v, struct v_row *rows, int n)
+{
+	if (!v || (!rows && n) || n < 0)
+		return V_ERR;
+
+	v_damage(v, v->nrows, -1);
+
+	if (!v->root && n && v_tree_root(v) == V_ERR)
+		return V_ERR;
+
+	return v_tree_put(v, v->nrows, rows, n);
+}
+
+/**
+ * v_tree_insert_rows - insert a batch of rows at a given line
+ * v: Pointer to the targeted v_state struct.
+ * y: The line number of the first new row, from 0 up to v->nrows.
+ * rows: The v_row structs to be inserted, in order.
+ * n: Number of v_row structs inside rows.
+ *
+ * Insert a batch of rows at a given line, just like v_tree_append() does at
+ * the end of the tree. The leaf holding line y is cut in two there once, the
+ * rows after y moving to a leaf of their own, then the rows are put in
+ * between the same way v_tree_append() puts them at the end: topping up the
+ * first leaf and filling brand new ones. Another batch inserted right after
+ * this one therefore doesn't cut any leaf. Should a leaf fail to be allocated
+ * halfway, the rows put so far stay in.
+ *
+ * Returns the newly updated number of v->nrows on success, V_ERR otherwise.
+ */
+int v_tree_insert_rows(struct v_state *v, int y, struct v_row *rows, int n)
+{
+	if (!v || (!rows && n) || n < 0 || y < 0 || y > v->nrows)
+		return V_ERR;
+
+	if (y == v->nrows)
+		return v_tree_append(v, rows, n);
+
+	if (!n)
+		return v->nrows;
+
+	struct v_path path[V_TREE_DEPTH];
+	int pos = 0;
+	struct v_leaf *leaf = v_tree_walk(v, y, true, path, &pos);
+	if (pos < leaf->n && v_tree_cut(v, path, leaf, pos) == V_ERR)
+		return V_ERR;
+
+	v_damage(v, y, -1);
+	v->rc_leaf = NULL;
+
+	return v_tree_put(v, y, rows, n);
+}
+
+/**
+ * v_tree_delete - remove the row of a given line
+ * v: Pointer to the targeted v_state struct.
+ * y: The line number of the removed row.
+ *
+ * Remove the row of a given line, shifting every row after it up by one line.
+ * The row must have been released by the caller beforehand, this function only
+ * takes care of its slot. Leaves which become too sparse are merged into one of
+ * their siblings.
+ *
+ * Returns the newly updated number of v->nrows on success, V_ERR otherwise.
+ */
+int v_tree_delete(struct v_state *v, int y)
+{
+	if (!v || !v->root || y < 0 || y >= v->nrows)
+		return V_ERR;
+
+	struct v_path path[V_TREE_DEPTH];
+	int pos = 0;
+	struct v_leaf *leaf = v_tree_walk(v, y, false, path, &pos);
+
+	memmove(&leaf->rows[pos], &leaf->rows[pos + 1],
+		sizeof(struct v_row) * (leaf->n - pos - 1));
+	leaf->n--;
+	v_damage(v, y, -1);
+
+	for (int d = 0; d < v->height; d++)
+		path[d].node->cnt[path[d].i]--;
+
+	v->nrows--;
+	v->rc_leaf = NULL;
+
+	struct v_path *up = &path[v->height - 1];
+	struct v_node *parent = up->node;
+	int i = up->i;
+
+	if (leaf->n == 0) {
+		v_tree_unlink_leaf(leaf);
+		v_tree_del_kid(v, path, v->height - 1);
+	} else if (leaf->n < V_LEAF_MAX / 4 && i > 0 &&
+		   parent->cnt[i - 1] + leaf->n <= V_LEAF_MAX) {
+		struct v_leaf *left = parent->kid[i - 1];
+		memcpy(&left->rows[left->n], leaf->rows,
+		       sizeof(struct v_row) * leaf->n);
+		left->n += leaf->n;
+		parent->cnt[i - 1] += leaf->n;
+		v_tree_unlink_leaf(leaf);
+		v_tree_del_kid(v, path, v->height - 1);
+	} else if (leaf->n < V_LEAF_MAX / 4 && i + 1 < parent->n &&
+		   parent->cnt[i + 1] + leaf->n <= V_LEAF_MAX) {
+		struct v_leaf *right = parent->kid[i + 1];
+		memcpy(&leaf->rows[leaf->n], right->rows,
+		       sizeof(struct v_row) * right->n);
+		leaf->n += right->n;
+		parent->cnt[i] += right->n;
+		up->i = i + 1;
+		v_tree_unlink_leaf(right);
+		v_tree_del_kid(v, path, v->height - 1);
+	}
+
+	while (v->height > 1 && v->root->n == 1) {
+		struct v_node *old = v->root;
+		v->root = old->kid[0];
+		v->height--;
+		free(old);
+	}
+
+	return v->nrows;
+}
+
+static void v_tree_free_node(struct v_node *node, int height)
+{
+	for (int i = 0; i < node->n; i++) {
+		if (height > 1)
+			v_tree_free_node(node->kid[i], height - 1);
+		else
+			free(node->kid[i]);
+	}
+
+	free(node);
+}
+
+/**
+ * v_tree_free - free the tree holding the rows of the specified v_state
+ * v: Pointer to the targeted v_state struct.
+ *
+ * Free every leaf and node of the tree holding the rows of the specified
+ * v_state. The rows themselves must have been released beforehand. v->nrows
+ * will be setted to 0.
+ *
+ * Returns V_OK on success, V_ERR otherwise.
+ */
+int v_tree_free(struct v_state *v)
+{
+	if (!v)
+		return V_ERR;
+
+	if (v->root)
+		v_tree_free_node(v->root, v->height);
+
+	v->root = NULL;
+	v->height = 0;
+	v->nrows = 0;
+	v->rc_leaf = NULL;
+	v->rc_base = 0;
+
+	return V_OK;
+}
@@ -0,0 +1,158 @@
+/*
+ * gap.c - Gap buffer row check
+ *
+ * Checks that the text of a row stored as a gap buffer always reads the same
+ * as a plain string edited the same way. Characters and strings are inserted
+ * and deleted at random places, the row is cut short and grown back, so that
+ * the gap keeps moving and the buffer keeps growing. The row starts off
+ * borrowing its text, as a freshly loaded row does. After every edit, the
+ * segments of the row and its rendering are compared to the plain string.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <void.h>
+
+#define V_TEST_EDITS	20000		/* Random edits made to the row */
+#define V_TEST_MAX	4096		/* Longest the row may get */
+
+static char ref[V_TEST_MAX];
+static int nref;
+
+/* Tells what differs between the row and ref, NULL if nothing does */
+static const char *v_test_check(struct v_state *v, struct v_row *row)
+{
+	static char buf[V_TEST_MAX * V_TABSTP];
+	char *s = NULL;
+	int len = 0;
+	int n = 0;
+
+	if (row->len != nref)
+		return "length";
+	if (row->cap && (row->gap > row->len || row->len > row->cap))
+		return "gap";
+
+	for (int i = 0; (n = v_row_seg(row, i, &s)) != V_ERR; i++) {
+		if (len + n > nref || memcmp(s, ref + len, n))
+			return "text";
+		len += n;
+	}
+	if (len != nref)
+		return "text";
+
+	/* Tabs go up to the next tab stop */
+	len = 0;
+	for (int i = 0; i < nref; i++) {
+		buf[len++] = ref[i] == '\t' ? ' ' : ref[i];
+		while (ref[i] == '\t' && len % V_TABSTP)
+			buf[len++] = ' ';
+	}
+
+	if (v_render_row(v, row) == V_ERR)
+		return "render";
+	if (row->rlen != len || memcmp(row->ren, buf, len))
+		return "rendering";
+
+	return NULL;
+}
+
+static int v_test_edit(struct v_state *v, struct v_row *row)
+{
+	static const char chars[] = "abcdefgh\t ";
+	char str[64];
+	int at = rand() % (nref + 1);
+	int n = 0;
+
+	switch (rand() % 6) {
+	case 0:
+	case 1:
+		if (nref == V_TEST_MAX)
+			return V_OK;
+		str[0] = chars[rand() % (sizeof(chars) - 1)];
+		memmove(ref + at + 1, ref + at, nref - at);
+		ref[at] = str[0];
+		nref++;
+		return v_row_insert_char(v, row, at, str[0]);
+	case 2:
+		n = rand() % sizeof(str);
+		if (nref + n > V_TEST_MAX)
+			return V_OK;
+		for (int i = 0; i < n; i++)
+			str[i] = chars[rand() % (sizeof(chars) - 1)];
+		memmove(ref + at + n, ref + at, nref - at);
+		memcpy(ref + at, str, n);
+		nref += n;
+		return v_row_insert_str(v, row, at, str, n);
+	case 3:
+	case 4:
+		if (at == nref)
+			return V_OK;
+		memmove(ref + at, ref + at + 1, nref - at - 1);
+		nref--;
+		return v_row_del_char(v, row, at);
+	default:
+		/* Cut short once in a while, grow back otherwise */
+		if (rand() % 8 == 0) {
+			nref = at;
+			return v_row_truncate(v, row, at);
+		}
+		n = rand() % sizeof(str);
+		if (nref + n > V_TEST_MAX)
+			return V_OK;
+		memset(str, 'z', n);
+		memcpy(ref + nref, str, n);
+		nref += n;
+		return v_row_append_str(v, row, str, n);
+	}
+}
+
+int main(void)
+{
+	static char text[] = "\tthe row starts off borrowing this text";
+	struct v_state *v = v_new_state();
+	if (!v) {
+		perror("state");
+		return EXIT_FAILURE;
+	}
+
+	nref = strlen(text);
+	memcpy(ref, text, nref);
+	if (v_insert_row_ref(v, 0, text, nref) == V_ERR) {
+		perror("row");
+		return EXIT_FAILURE;
+	}
+
+	srand(1);
+	const char *err = v_test_check(v, v_row_at(v, 0));
+	for (int i = 0; i < V_TEST_EDITS && !err; i++) {
+		struct v_row *row = v_row_at(v, 0);
+		if (v_test_edit(v, row) == V_ERR)
+			err = "edit";
+		else
+			err = v_test_check(v, row);
+		if (err)
+			printf("gap: %s differs after edit %d\n", err, i);
+	}
+
+	if (!err && strcmp(text, "\tthe row starts off borrowing this text")) {
+		printf("gap: the borrowed text got written to\n");
+		err = "text";
+	}
+
+	v_free_rows(v);
+	free(v);
+	if (err)
+		return EXIT_FAILURE;
+
+	printf("gap: ok\n");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,238 @@
+/*
+ * jrnl.c - Edit journal replay check
+ *
+ * Checks that the edits journaled by a session dying without saving are all
+ * carried out again once the same file is opened anew. A file is edited at
+ * random through the editor operations, a paste too big for the journal
+ * buffer included, then left without closing the journal, as a crash would.
+ * A torn record is appended to the swap file, which the replay must stop at.
+ * The recovered buffer must match the one left behind. Once saved, only the
+ * edits made since must be replayed, and a swap file meant for another
+ * version of the file must not be replayed at all, but taken over and
+ * removed on quitting.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <void.h>
+
+#define V_TEST_LINES	1000		/* Lines of the edited file */
+#define V_TEST_EDITS	2000		/* Random edits made per session */
+#define V_TEST_PASTE	(V_JRNL_BUF * 3)	/* Length of the big paste */
+#define V_TEST_SIZE	(V_TEST_PASTE * 4)	/* Room for the content */
+
+static char dir[] = "/tmp/void-jrnl-XXXXXX";
+static char path[sizeof(dir) + 16];
+static char swap[sizeof(dir) + 16];
+
+/* Copies the buffer content out as it would be saved */
+static size_t v_test_text(struct v_state *v, char *buf)
+{
+	size_t len = 0;
+
+	for (int y = 0; y < v->nrows; y++) {
+		struct v_row *row = v_row_at(v, y);
+		char *s = NULL;
+		int n = 0;
+
+		for (int i = 0; (n = v_row_seg(row, i, &s)) != V_ERR; i++) {
+			memcpy(buf + len, s, n);
+			len += n;
+		}
+		buf[len++] = '\n';
+	}
+
+	return len;
+}
+
+static int v_test_edit(struct v_state *v)
+{
+	static char big[V_TEST_PASTE];
+	static char *pastes[] = {"xyz", "ab\ncd\n", "\n"};
+
+	for (size_t i = 0; i < sizeof(big); i++)
+		big[i] = i % 64 == 63 ? '\n' : 'a' + i % 26;
+
+	for (int i = 0; i < V_TEST_EDITS; i++) {
+		int y = rand() % v->nrows;
+		int x = rand() % (v_row_at(v, y)->len + 1);
+		char *s = pastes[rand() % 3];
+		int ret = V_OK;
+
+		v->cur_y = y;
+		v->cur_x = x;
+		switch (rand() % 5) {
+		case 0:
+			ret = v_insert(v, 'a' + rand() % 26);
+			break;
+		case 1:
+			ret = v_insert_nl(v);
+			break;
+		case 2:
+			if (x || y)
+				ret = v_bksp(v);
+			break;
+		case 3:
+			ret = v_paste(v, s, strlen(s));
+			break;
+		default:
+			ret = v_open_line(v, y + rand() % 2);
+		}
+		if (ret == V_ERR)
+			return V_ERR;
+	}
+
+	v->cur_y = v->nrows / 2;
+	v->cur_x = 0;
+
+	return v_paste(v, big, sizeof(big));
+}
+
+/* Opens the file, replaying what its swap file holds */
+static struct v_state *v_test_open(void)
+{
+	struct v_state *v = v_new_state();
+	if (!v)
+		return NULL;
+
+	if (v_open(v, path) == V_ERR || v_jrnl_open(v) == V_ERR) {
+		v_free_rows(v);
+		free(v->filename);
+		free(v);
+		return NULL;
+	}
+
+	return v;
+}
+
+/* Leaves the swap file behind, as a dying session does */
+static void v_test_crash(struct v_state *v)
+{
+	v_jrnl_sync(v);
+	v_free_rows(v);
+	free(v->filename);
+	free(v);
+}
+
+static void v_test_close(struct v_state *v)
+{
+	v_jrnl_close(v);
+	v_free_rows(v);
+	free(v->filename);
+	free(v);
+}
+
+static bool v_test_same(struct v_state *v, char *text, size_t len)
+{
+	static char buf[V_TEST_SIZE];
+
+	return v_test_text(v, buf) == len && !memcmp(buf, text, len);
+}
+
+static const char *v_test_run(void)
+{
+	static char want[V_TEST_SIZE];
+	static char start[V_TEST_SIZE];
+
+	FILE *fp = fopen(path, "w");
+	if (!fp)
+		return "writing the file";
+	for (int i = 0; i < V_TEST_LINES; i++)
+		fprintf(fp, "line %d\n", i);
+	if (fclose(fp) != 0)
+		return "writing the file";
+
+	/* A session dies after editing the file */
+	struct v_state *v = v_test_open();
+	if (!v)
+		return "opening the file";
+	size_t slen = v_test_text(v, start);
+	if (v_test_edit(v) == V_ERR)
+		return "editing";
+	size_t len = v_test_text(v, want);
+	v_test_crash(v);
+
+	/* Half of a record made it to the disk */
+	fp = fopen(swap, "a");
+	if (!fp || fwrite("\x01\x02\x03\x04\x01\x00", 1, 6, fp) != 6)
+		return "tearing a record";
+	fclose(fp);
+
+	v = v_test_open();
+	if (!v || !v_test_same(v, want, len) || !v->dirty)
+		return "replaying the edits";
+
+	/* Only the edits made since the last save are journaled */
+	if (v_save_start(v) == V_ERR || v_save_poll(v, true) == V_ERR)
+		return "saving";
+	if (v_test_edit(v) == V_ERR)
+		return "editing again";
+	len = v_test_text(v, want);
+	v_test_crash(v);
+
+	v = v_test_open();
+	if (!v || !v_test_same(v, want, len))
+		return "replaying the edits made since a save";
+	v_test_crash(v);
+
+	/* The file changed meanwhile, the edits don't apply anymore */
+	memcpy(start + slen, "changed\n", 8);
+	slen += 8;
+	fp = fopen(path, "w");
+	if (!fp || fwrite(start, 1, slen, fp) != slen || fclose(fp) != 0)
+		return "rewriting the file";
+
+	v = v_test_open();
+	if (!v || !v_test_same(v, start, slen))
+		return "leaving another version alone";
+
+	/* The first edit takes the swap file over, quitting removes it */
+	v->cur_y = 0;
+	v->cur_x = 0;
+	if (v_insert(v, 'a') == V_ERR)
+		return "editing another version";
+	v_jrnl_sync(v);
+	v_test_close(v);
+
+	if (access(swap, F_OK) == 0)
+		return "removing the swap file";
+
+	return NULL;
+}
+
+int main(void)
+{
+	if (!mkdtemp(dir)) {
+		perror("mkdtemp");
+		return EXIT_FAILURE;
+	}
+
+	snprintf(path, sizeof(path), "%s/file", dir);
+	snprintf(swap, sizeof(swap), "%s/.file%s", dir, V_JRNL_EXT);
+
+	srand(17);
+	const char *err = v_test_run();
+
+	unlink(swap);
+	unlink(path);
+	rmdir(dir);
+
+	if (err) {
+		printf("jrnl: %s went wrong\n", err);
+		return EXIT_FAILURE;
+	}
+
+	printf("jrnl: ok\n");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+/*
+ * keys.c - Queued key processing check
+ *
+ * Checks that keys typed ahead of a refresh land the cursor where they would
+ * have, had the screen been refreshed after each of them. Two Page Down keys
+ * are queued and processed in one batch by v_prcs_keys(), then the same is
+ * done one key per refresh, and both must move the cursor two pages down.
+ * The editor draws on a pretend xterm whose output goes into a temporary
+ * file.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ncurses.h>
+
+#include <void.h>
+
+#define V_TEST_LINES	1000		/* Lines of the edited buffer */
+#define V_TEST_TERM	"xterm-256color"	/* Pretend terminal type */
+
+static int v_test_fill(struct v_state *v)
+{
+	static char text[V_TEST_LINES * 16];
+	static struct v_line lines[V_TEST_LINES];
+	char *p = text;
+
+	for (int i = 0; i < V_TEST_LINES; i++) {
+		int len = sprintf(p, "line %d", i);
+		lines[i].s = p;
+		lines[i].len = len;
+		p += len;
+	}
+
+	return v_append_rows(v, lines, V_TEST_LINES);
+}
+
+/* Cursor row after n Page Down keys, processed per batch of batch keys */
+static int v_test_npage(struct v_state *v, int n, int batch)
+{
+	v->cur_y = 0;
+	v->cur_x = 0;
+	v->rowoff = 0;
+	v->batch = batch;
+	v_rfsh_scr(v);
+
+	for (int i = 0; i < n; i++)
+		ungetch(KEY_NPAGE);
+
+	while (n > 0) {
+		v_prcs_keys(v);
+		v_rfsh_scr(v);
+		n -= batch;
+	}
+
+	return v->cur_y;
+}
+
+int main(void)
+{
+	FILE *out = tmpfile();
+	FILE *in = fopen("/dev/null", "r");
+	if (!out || !in) {
+		perror("tmpfile");
+		return EXIT_FAILURE;
+	}
+
+	setenv("LINES", "24", 1);
+	setenv("COLUMNS", "80", 1);
+	SCREEN *term = newterm(V_TEST_TERM, out, in);
+	if (!term) {
+		fprintf(stderr, "keys: no %s terminal\n", V_TEST_TERM);
+		return EXIT_SUCCESS;
+	}
+
+	struct v_state *v = v_new_state();
+	if (!v || v_test_fill(v) == V_ERR) {
+		perror("fill");
+		return EXIT_FAILURE;
+	}
+
+	int one = v_test_npage(v, 2, 1);
+	int batched = v_test_npage(v, 2, 2);
+
+	endwin();
+	delscreen(term);
+	fclose(in);
+	fclose(out);
+
+	if (batched != one || one <= 2 * (LINES - 2) - 2) {
+		printf("keys: 2 x Page Down went to row %d batched, %d not\n",
+		       batched, one);
+		return EXIT_FAILURE;
+	}
+
+	printf("keys: ok\n");
+
+	return EXIT_SUCCESS;
+}
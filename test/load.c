@@ -0,0 +1,191 @@
+/*
+ * load.c - Multithreaded loading check
+ *
+ * Checks that a file indexed by several threads ends up in the exact same
+ * rows as when a single thread goes through it. The file is over three
+ * V_INDEX_BLK long, so that it gets cut into chunks, and mixes "\n" with
+ * "\r\n" line terminators. A "\r\n" is split right where the chunks are cut,
+ * a line of over a megabyte runs over one of the cuts and the last line has
+ * no terminator. It is loaded with 1 thread and then with 2, 3 and 4 of them,
+ * in every loading mode, and the rows are compared byte for byte.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <void.h>
+
+#define V_TEST_SIZE	(13 * 1048576)	/* Bytes of the loaded file */
+#define V_TEST_LONG	(9 * 1048576)	/* Start of the line over a cut */
+#define V_TEST_LLEN	(3 * 1048576 / 2)	/* Length of that line */
+
+static char *v_test_text(size_t len)
+{
+	char *s = malloc(len);
+	if (!s)
+		return NULL;
+
+	srand(13);
+	for (size_t i = 0; i < len; ) {
+		size_t n = rand() % 120;
+		for (size_t j = 0; j < n && i < len; j++, i++)
+			s[i] = 'a' + i % 26;
+		if (rand() % 3 == 0 && i < len)
+			s[i++] = '\r';
+		if (i < len)
+			s[i++] = '\n';
+	}
+
+	memset(s + V_TEST_LONG, '-', V_TEST_LLEN);
+
+	/* Where v_index_round() cuts a round of len bytes into k chunks */
+	for (size_t k = 2; k <= 4; k++) {
+		size_t round = len < k * V_INDEX_BLK ? len : k * V_INDEX_BLK;
+		for (size_t i = 1; i < k; i++) {
+			size_t cut = round / k * i;
+			if (cut - V_TEST_LONG <= V_TEST_LLEN)
+				continue;
+			s[cut - 1] = '\r';
+			s[cut] = '\n';
+		}
+	}
+
+	s[len - 1] = '.';
+
+	return s;
+}
+
+static int v_test_write(char *path, char *s, size_t len)
+{
+	FILE *fp = fopen(path, "w");
+	if (!fp)
+		return V_ERR;
+
+	size_t n = fwrite(s, 1, len, fp);
+	if (fclose(fp) != 0 || n != len)
+		return V_ERR;
+
+	return V_OK;
+}
+
+static void v_test_free(struct v_state *v)
+{
+	if (!v)
+		return;
+
+	v_free_rows(v);
+	free(v->filename);
+	free(v);
+}
+
+static struct v_state *v_test_load(char *path, int mode, int threads)
+{
+	struct v_state *v = v_new_state();
+	if (!v)
+		return NULL;
+
+	v->pt = mode == 1;
+	v->mm = mode == 2;
+	v->threads = threads;
+	if (v_open(v, path) == V_ERR) {
+		v_test_free(v);
+		return NULL;
+	}
+
+	return v;
+}
+
+/* Copies the text of a row out of its segments */
+static int v_test_text_of(struct v_row *row, char *buf)
+{
+	char *s = NULL;
+	int len = 0;
+	int n = 0;
+
+	for (int i = 0; (n = v_row_seg(row, i, &s)) != V_ERR; i++) {
+		memcpy(buf + len, s, n);
+		len += n;
+	}
+
+	return len;
+}
+
+/* Returns the first row told apart, -1 if there is none */
+static int v_test_cmp(struct v_state *a, struct v_state *b, char *x, char *y)
+{
+	if (a->nrows != b->nrows)
+		return a->nrows < b->nrows ? a->nrows : b->nrows;
+
+	for (int i = 0; i < a->nrows; i++) {
+		int n = v_test_text_of(v_row_at(a, i), x);
+		int m = v_test_text_of(v_row_at(b, i), y);
+		if (n != m || memcmp(x, y, n))
+			return i;
+	}
+
+	return -1;
+}
+
+int main(void)
+{
+	static const char *modes[] = {"read", "piece table", "mapped"};
+	char path[] = "/tmp/void-load-XXXXXX";
+	int ret = EXIT_SUCCESS;
+
+	int fd = mkstemp(path);
+	if (fd == -1) {
+		perror("mkstemp");
+		return EXIT_FAILURE;
+	}
+	close(fd);
+
+	char *text = v_test_text(V_TEST_SIZE);
+	char *x = malloc(V_TEST_SIZE);
+	char *y = malloc(V_TEST_SIZE);
+	if (!text || !x || !y ||
+	    v_test_write(path, text, V_TEST_SIZE) == V_ERR) {
+		perror("write");
+		unlink(path);
+		return EXIT_FAILURE;
+	}
+
+	for (int mode = 0; mode < 3 && ret == EXIT_SUCCESS; mode++) {
+		struct v_state *one = v_test_load(path, mode, 1);
+		if (!one) {
+			perror("load");
+			ret = EXIT_FAILURE;
+			break;
+		}
+
+		for (int n = 2; n <= 4; n++) {
+			struct v_state *v = v_test_load(path, mode, n);
+			int row = v ? v_test_cmp(one, v, x, y) : 0;
+			if (row != -1) {
+				printf("load: %s mode, -j%d differs from -j1 "
+				       "at row %d\n", modes[mode], n, row);
+				ret = EXIT_FAILURE;
+			}
+			v_test_free(v);
+		}
+
+		v_test_free(one);
+	}
+
+	unlink(path);
+	free(text);
+	free(x);
+	free(y);
+
+	if (ret == EXIT_SUCCESS)
+		printf("load: ok\n");
+
+	return ret;
+}
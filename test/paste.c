@@ -0,0 +1,297 @@
+/*
+ * paste.c - Paste splitting check
+ *
+ * Checks that pasted text is split into the rows it holds. Texts of one line,
+ * a few lines, an empty line and just below, at and past a whole batch of
+ * lines are pasted into the middle of rows, at their start and past the last
+ * row, with and without a final newline, in both the row and the piece table
+ * modes. The rows and the cursor must end up as if the text was typed in.
+ * Then a bracketed paste longer than a read block, with its end sequence
+ * split between two blocks, is fed to the keys of a pretend xterm. Its line
+ * terminators must all come out as new rows, its control characters left
+ * out, and the keys typed right after it still typed in.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <ncurses.h>
+
+#include <void.h>
+
+#define V_TEST_OLD	"alpha\nbeta\ngamma\n"	/* Content before pasting */
+#define V_TEST_SIZE	(V_READ_BLK * 2)	/* Room for the content */
+#define V_TEST_KEYS	(V_READ_BLK - 3)	/* Length of the keyed paste */
+#define V_TEST_TERM	"xterm-256color"	/* Pretend terminal type */
+
+static char path[] = "/tmp/void-paste-XXXXXX";
+
+static char want[V_TEST_SIZE];
+static size_t nwant;
+
+/* Copies the buffer content out as it would be saved */
+static size_t v_test_text(struct v_state *v, char *buf)
+{
+	size_t len = 0;
+
+	for (int y = 0; y < v->nrows; y++) {
+		struct v_row *row = v_row_at(v, y);
+		char *s = NULL;
+		int n = 0;
+
+		for (int i = 0; (n = v_row_seg(row, i, &s)) != V_ERR; i++) {
+			memcpy(buf + len, s, n);
+			len += n;
+		}
+		buf[len++] = '\n';
+	}
+
+	return len;
+}
+
+static bool v_test_same(struct v_state *v)
+{
+	static char buf[V_TEST_SIZE];
+
+	return v_test_text(v, buf) == nwant && !memcmp(buf, want, nwant);
+}
+
+/* Pastes s at row y, column x and types it into the expected text alike */
+static bool v_test_paste(struct v_state *v, int y, int x, char *s)
+{
+	size_t len = strlen(s);
+	size_t off = 0;
+
+	for (int i = 0; i < y && off < nwant; off++)
+		if (want[off] == '\n')
+			i++;
+	off += x;
+
+	/* Past the last row, a new empty row is pasted into */
+	if (y == v->nrows) {
+		want[nwant++] = '\n';
+		off = nwant - 1;
+	}
+
+	memmove(want + off + len, want + off, nwant - off);
+	memcpy(want + off, s, len);
+	nwant += len;
+
+	char *nl = strrchr(s, '\n');
+	int lines = 0;
+	for (char *p = s; (p = strchr(p, '\n')); p++)
+		lines++;
+
+	v->cur_y = y;
+	v->cur_x = x;
+	if (v_paste(v, s, len) == V_ERR)
+		return false;
+
+	return v_test_same(v) && v->dirty && v->cur_y == y + lines &&
+	       v->cur_x == (nl ? (int)(s + len - (nl + 1)) : x + (int)len);
+}
+
+/* Text of n lines, each one told apart, ending with a newline if nl */
+static char *v_test_lines(int n, bool nl)
+{
+	static char buf[V_PASTE_BATCH * 4 * 16];
+	char *p = buf;
+
+	for (int i = 0; i < n; i++)
+		p += sprintf(p, "%d%s", i, i < n - 1 || nl ? "\n" : "");
+
+	return buf;
+}
+
+static const char *v_test_mode(bool pt)
+{
+	int counts[] = {
+		V_PASTE_BATCH - 1, V_PASTE_BATCH, V_PASTE_BATCH + 1,
+		V_PASTE_BATCH * 3 + 5,
+	};
+	const char *err = NULL;
+
+	struct v_state *v = v_new_state();
+	if (!v)
+		return "state";
+
+	v->pt = pt;
+	if (v_open(v, path) == V_ERR) {
+		err = "opening the file";
+		goto out;
+	}
+	nwant = strlen(V_TEST_OLD);
+	memcpy(want, V_TEST_OLD, nwant);
+
+	if (!v_test_paste(v, 1, 2, "one") ||
+	    !v_test_paste(v, 1, 2, "two\n\nthree") ||
+	    !v_test_paste(v, 0, 0, "first\n") ||
+	    !v_test_paste(v, 2, 5, "\n") ||
+	    !v_test_paste(v, v->nrows, 0, "last") ||
+	    !v_test_paste(v, v->nrows, 0, "after\nthe end\n")) {
+		err = "pasting a few lines";
+		goto out;
+	}
+
+	for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+		int y = v->nrows / 2;
+		int x = v_row_at(v, y)->len / 2;
+
+		if (!v_test_paste(v, y, x, v_test_lines(counts[i], i % 2)) ||
+		    !v_test_paste(v, y, 0, v_test_lines(counts[i], !(i % 2)))) {
+			err = "pasting batches of lines";
+			goto out;
+		}
+	}
+
+out:
+	v_free_rows(v);
+	free(v->filename);
+	free(v);
+
+	return err;
+}
+
+/*
+ * Writes a bracketed paste to fp, lines ended every way a terminal may end
+ * them, followed by keys typed ahead. Expects it inside "<>".
+ */
+static int v_test_keyed(FILE *fp)
+{
+	static char raw[V_TEST_KEYS];
+	static char *ends[] = {"\r\n", "\n", "\r", "\r\n\r\n"};
+	size_t n = 0;
+
+	nwant = 0;
+	want[nwant++] = '<';
+	for (int i = 0; n + 64 < sizeof(raw); i++) {
+		int len = sprintf(raw + n, "line\t%d", i);
+		memcpy(want + nwant, raw + n, len);
+		n += len;
+		nwant += len;
+
+		/* Control characters other than tabs are left out */
+		if (i % 7 == 0)
+			raw[n++] = '\001';
+
+		char *e = ends[i % 4];
+		memcpy(raw + n, e, strlen(e));
+		n += strlen(e);
+		want[nwant++] = '\n';
+		if (i % 4 == 3)
+			want[nwant++] = '\n';
+	}
+	memset(raw + n, 'z', sizeof(raw) - n);
+	memset(want + nwant, 'z', sizeof(raw) - n);
+	nwant += sizeof(raw) - n;
+	memcpy(want + nwant, "XY>\n", 4);
+	nwant += 4;
+
+	if (fputs(V_PASTE_BEGIN, fp) == EOF ||
+	    fwrite(raw, 1, sizeof(raw), fp) != sizeof(raw) ||
+	    fputs(V_PASTE_END "XY", fp) == EOF || fflush(fp) == EOF)
+		return V_ERR;
+
+	return V_OK;
+}
+
+/* Feeds the paste to the keys read from stdin, as typed on a terminal */
+static const char *v_test_keys(void)
+{
+	const char *err = NULL;
+
+	FILE *in = fopen(path, "w+");
+	FILE *out = tmpfile();
+	if (!in || !out || v_test_keyed(in) == V_ERR)
+		return "writing the keys";
+	rewind(in);
+	if (dup2(fileno(in), STDIN_FILENO) == -1)
+		return "reading the keys";
+
+	setenv("LINES", "24", 1);
+	setenv("COLUMNS", "80", 1);
+	SCREEN *term = newterm(V_TEST_TERM, out, stdin);
+	if (!term) {
+		fprintf(stderr, "paste: no %s terminal\n", V_TEST_TERM);
+		fclose(in);
+		fclose(out);
+		return NULL;
+	}
+
+	raw();
+	keypad(stdscr, TRUE);
+	noecho();
+	define_key(V_PASTE_BEGIN, V_KEY_PASTE);
+	define_key(V_PASTE_END, V_KEY_PASTE_END);
+
+	struct v_state *v = v_new_state();
+	if (!v || v_insert_row(v, 0, "<>", 2) == V_ERR) {
+		err = "state";
+		goto out;
+	}
+	v->cur_x = 1;
+	v->mode = V_INSERT;
+	v->batch = 1;
+	v_rfsh_scr(v);
+
+	/* The paste, then each key typed after it */
+	for (int i = 0; i < 3; i++)
+		v_prcs_keys(v);
+
+	if (!v_test_same(v))
+		err = "pasting through the keys";
+	else if (v->mode != V_INSERT)
+		err = "the keys typed after a paste";
+
+out:
+	if (v) {
+		v_free_rows(v);
+		free(v);
+	}
+	endwin();
+	delscreen(term);
+	fclose(in);
+	fclose(out);
+
+	return err;
+}
+
+int main(void)
+{
+	int fd = mkstemp(path);
+	FILE *fp = fd == -1 ? NULL : fdopen(fd, "w");
+	if (!fp) {
+		perror("mkstemp");
+		return EXIT_FAILURE;
+	}
+
+	if (fputs(V_TEST_OLD, fp) == EOF || fclose(fp) != 0) {
+		perror("write");
+		unlink(path);
+		return EXIT_FAILURE;
+	}
+
+	const char *err = v_test_mode(false);
+	if (!err)
+		err = v_test_mode(true);
+	if (!err)
+		err = v_test_keys();
+
+	unlink(path);
+	if (err) {
+		printf("paste: %s went wrong\n", err);
+		return EXIT_FAILURE;
+	}
+
+	printf("paste: ok\n");
+
+	return EXIT_SUCCESS;
+}
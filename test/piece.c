@@ -0,0 +1,194 @@
+/*
+ * piece.c - Piece table buffer check
+ *
+ * Checks that a file loaded in piece table mode and edited at random reads the
+ * same as plain strings edited the same way. Characters and short pastes are
+ * inserted, lines are split and joined back, and characters are backspaced,
+ * so that pieces get cut, extended and shared between rows. The rows are
+ * compared to the plain strings after every edit, and the text the file was
+ * loaded into must still be the same once done.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <void.h>
+
+#define V_TEST_LINES	200		/* Lines of the loaded file */
+#define V_TEST_EDITS	20000		/* Random edits made to the buffer */
+#define V_TEST_ROWS	1024		/* Most rows the buffer may get */
+#define V_TEST_LEN	256		/* Longest a row may get */
+
+static char ref[V_TEST_ROWS][V_TEST_LEN];
+static int rlen[V_TEST_ROWS];
+static int nref;
+
+/* Inserts s at x of row y, its '\n' splitting the row */
+static void v_test_put(int y, int x, char *s, int n)
+{
+	char line[V_TEST_LEN * 2];
+	int len = 0;
+
+	memcpy(line, ref[y], x);
+	memcpy(line + x, s, n);
+	memcpy(line + x + n, ref[y] + x, rlen[y] - x);
+	len = rlen[y] + n;
+
+	for (char *p = line; ; y++) {
+		char *nl = memchr(p, '\n', line + len - p);
+		int k = (nl ? nl : line + len) - p;
+		memcpy(ref[y], p, k);
+		rlen[y] = k;
+		if (!nl)
+			break;
+
+		int rest = nref - y - 1;
+		memmove(ref[y + 2], ref[y + 1], sizeof(ref[0]) * rest);
+		memmove(rlen + y + 2, rlen + y + 1, sizeof(int) * rest);
+		nref++;
+		p = nl + 1;
+	}
+}
+
+static void v_test_bksp(int y, int x)
+{
+	if (x) {
+		memmove(ref[y] + x - 1, ref[y] + x, rlen[y] - x);
+		rlen[y]--;
+		return;
+	}
+
+	memcpy(ref[y - 1] + rlen[y - 1], ref[y], rlen[y]);
+	rlen[y - 1] += rlen[y];
+	memmove(ref[y], ref[y + 1], sizeof(ref[0]) * (nref - y - 1));
+	memmove(rlen + y, rlen + y + 1, sizeof(int) * (nref - y - 1));
+	nref--;
+}
+
+static int v_test_edit(struct v_state *v)
+{
+	static char *pastes[] = {"x", "pasted", "a\nb", "\n\n", "tail\n"};
+	int y = rand() % nref;
+	int x = rand() % (rlen[y] + 1);
+	char c = 'a' + rand() % 26;
+
+	v->cur_y = y;
+	v->cur_x = x;
+	switch (rand() % 4) {
+	case 0:
+		if (rlen[y] + 1 >= V_TEST_LEN)
+			return V_OK;
+		v_test_put(y, x, &c, 1);
+		return v_insert(v, c);
+	case 1: {
+		char *s = pastes[rand() % 5];
+		int n = strlen(s);
+		if (rlen[y] + n >= V_TEST_LEN || nref + n >= V_TEST_ROWS)
+			return V_OK;
+		v_test_put(y, x, s, n);
+		return v_paste(v, s, n);
+	}
+	case 2:
+		if (nref + 1 >= V_TEST_ROWS)
+			return V_OK;
+		v_test_put(y, x, "\n", 1);
+		return v_insert_nl(v);
+	default:
+		if ((!x && !y) || (!x && rlen[y - 1] + rlen[y] >= V_TEST_LEN))
+			return V_OK;
+		v_test_bksp(y, x);
+		return v_bksp(v);
+	}
+}
+
+/* Returns the first row told apart from ref, -1 if there is none */
+static int v_test_cmp(struct v_state *v)
+{
+	if (v->nrows != nref)
+		return v->nrows < nref ? v->nrows : nref;
+
+	for (int y = 0; y < nref; y++) {
+		struct v_row *row = v_row_at(v, y);
+		char *s = NULL;
+		int len = 0;
+		int n = 0;
+
+		for (int i = 0; (n = v_row_seg(row, i, &s)) != V_ERR; i++) {
+			if (len + n > rlen[y] || memcmp(s, ref[y] + len, n))
+				return y;
+			len += n;
+		}
+		if (len != rlen[y])
+			return y;
+	}
+
+	return -1;
+}
+
+int main(void)
+{
+	static char text[V_TEST_LINES * 16];
+	char path[] = "/tmp/void-piece-XXXXXX";
+	size_t size = 0;
+
+	for (nref = 0; nref < V_TEST_LINES; nref++) {
+		rlen[nref] = sprintf(ref[nref], "line %d", nref);
+		size += sprintf(text + size, "%s\n", ref[nref]);
+	}
+
+	int fd = mkstemp(path);
+	if (fd == -1 || write(fd, text, size) != (ssize_t)size) {
+		perror("write");
+		return EXIT_FAILURE;
+	}
+	close(fd);
+
+	struct v_state *v = v_new_state();
+	if (!v) {
+		perror("state");
+		return EXIT_FAILURE;
+	}
+
+	v->pt = true;
+	int ret = v_open(v, path);
+	unlink(path);
+	if (ret == V_ERR || !v->src) {
+		perror("load");
+		return EXIT_FAILURE;
+	}
+
+	srand(2);
+	int row = v_test_cmp(v);
+	for (int i = 0; i < V_TEST_EDITS && row == -1; i++) {
+		if (v_test_edit(v) == V_ERR) {
+			printf("piece: edit %d failed\n", i);
+			return EXIT_FAILURE;
+		}
+		row = v_test_cmp(v);
+		if (row != -1)
+			printf("piece: row %d differs after edit %d\n", row, i);
+	}
+
+	if (row == -1 && memcmp(v->src, text, size)) {
+		printf("piece: the loaded text got written to\n");
+		row = 0;
+	}
+
+	v_free_rows(v);
+	free(v->filename);
+	free(v);
+	if (row != -1)
+		return EXIT_FAILURE;
+
+	printf("piece: ok\n");
+
+	return EXIT_SUCCESS;
+}
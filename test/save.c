@@ -0,0 +1,210 @@
+/*
+ * save.c - Atomic save check
+ *
+ * Checks that saving replaces a file through a temporary file renamed over
+ * it. The saved file must hold the new content and keep its mode, and no
+ * temporary file may be left behind. A symbolic link must still point to the
+ * file it pointed to. A file with a second hard link is written in place, so
+ * that both names still share the new content. A file whose rows still refer
+ * to its mapping must be replaced, so that those rows keep their text. A
+ * file that can't be written must fail to save and leave the buffer dirty.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <void.h>
+
+#define V_TEST_OLD	"first\nsecond\n"	/* Content before saving */
+#define V_TEST_NEW	V_TEST_OLD "added\n"	/* Content after saving */
+
+static char dir[] = "/tmp/void-save-XXXXXX";
+
+/* Two paths at a time may be in use, as link() takes */
+static char *v_test_path(char *name)
+{
+	static char path[2][sizeof(dir) + 64];
+	static int i;
+
+	i = !i;
+	snprintf(path[i], sizeof(path[i]), "%s/%s", dir, name);
+
+	return path[i];
+}
+
+static int v_test_write(char *name, mode_t mode)
+{
+	int fd = open(v_test_path(name), O_WRONLY | O_CREAT | O_TRUNC, mode);
+	if (fd == -1)
+		return V_ERR;
+
+	ssize_t n = write(fd, V_TEST_OLD, strlen(V_TEST_OLD));
+	fchmod(fd, mode);
+	if (close(fd) == -1 || n != (ssize_t)strlen(V_TEST_OLD))
+		return V_ERR;
+
+	return V_OK;
+}
+
+static bool v_test_holds(char *name, char *text)
+{
+	char buf[256];
+	int fd = open(v_test_path(name), O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	ssize_t n = read(fd, buf, sizeof(buf));
+	close(fd);
+
+	return n == (ssize_t)strlen(text) && !memcmp(buf, text, n);
+}
+
+/*
+ * Opens name, adds a line and saves it as as, or as name when as is NULL.
+ * Tells whether the first row kept its text and whether the buffer is left
+ * dirty. Returns the outcome of saving.
+ */
+static int v_test_save(char *name, char *as, bool mm, bool *kept, bool *dirty)
+{
+	struct v_state *v = v_new_state();
+	if (!v)
+		return V_ERR;
+
+	v->mm = mm;
+	v->sync = V_SYNC_FULL;
+	int ret = v_open(v, v_test_path(name));
+	if (ret != V_ERR && as) {
+		free(v->filename);
+		v->filename = strdup(v_test_path(as));
+	}
+	if (ret != V_ERR && !v->filename)
+		ret = V_ERR;
+	if (ret != V_ERR)
+		ret = v_insert_row(v, v->nrows, "added", 5);
+	if (ret != V_ERR)
+		ret = v_save_start(v);
+	if (ret != V_ERR)
+		ret = v_save_poll(v, true);
+
+	/* The rows must not have changed under our feet */
+	char *s = NULL;
+	struct v_row *row = v->nrows ? v_row_at(v, 0) : NULL;
+	*kept = row && v_row_seg(row, 0, &s) == 5 && !memcmp(s, "first", 5);
+	*dirty = v->dirty;
+
+	v_jrnl_close(v);
+	v_free_rows(v);
+	free(v->filename);
+	free(v);
+
+	return ret;
+}
+
+static int v_test_count(void)
+{
+	DIR *d = opendir(dir);
+	if (!d)
+		return -1;
+
+	int n = 0;
+	struct dirent *de = NULL;
+	while ((de = readdir(d)))
+		if (strcmp(de->d_name, ".") && strcmp(de->d_name, ".."))
+			n++;
+	closedir(d);
+
+	return n;
+}
+
+static const char *v_test_run(void)
+{
+	struct stat before;
+	struct stat after;
+	bool kept = false;
+	bool dirty = false;
+
+	if (v_test_write("file", 0640) == V_ERR ||
+	    v_test_write("linked", 0644) == V_ERR ||
+	    link(v_test_path("linked"), v_test_path("link")) == -1 ||
+	    v_test_write("mapped", 0600) == V_ERR ||
+	    symlink("file", v_test_path("symlink")) == -1)
+		return "setting up";
+
+	stat(v_test_path("file"), &before);
+	if (v_test_save("file", NULL, false, &kept, &dirty) == V_ERR || !kept)
+		return "saving a file";
+	stat(v_test_path("file"), &after);
+	if (!v_test_holds("file", V_TEST_NEW))
+		return "saved content";
+	if (after.st_ino == before.st_ino)
+		return "replacing the file";
+	if ((after.st_mode & 07777) != 0640)
+		return "keeping the mode";
+
+	if (v_test_save("symlink", NULL, false, &kept, &dirty) == V_ERR ||
+	    lstat(v_test_path("symlink"), &after) == -1 ||
+	    !S_ISLNK(after.st_mode))
+		return "saving through a symbolic link";
+	if (!v_test_holds("file", V_TEST_NEW "added\n"))
+		return "content saved through a symbolic link";
+
+	stat(v_test_path("linked"), &before);
+	if (v_test_save("linked", NULL, false, &kept, &dirty) == V_ERR)
+		return "saving a file with two links";
+	stat(v_test_path("linked"), &after);
+	if (after.st_ino != before.st_ino || !v_test_holds("link", V_TEST_NEW))
+		return "keeping hard links";
+
+	stat(v_test_path("mapped"), &before);
+	if (v_test_save("mapped", NULL, true, &kept, &dirty) == V_ERR || !kept)
+		return "saving a mapped file";
+	stat(v_test_path("mapped"), &after);
+	if (after.st_ino == before.st_ino ||
+	    !v_test_holds("mapped", V_TEST_NEW))
+		return "replacing a mapped file";
+
+	if (v_test_save("file", "none/file", false, &kept, &dirty) != V_ERR ||
+	    !dirty)
+		return "failing to save";
+
+	if (v_test_count() != 5)
+		return "leaving no temporary file";
+
+	return NULL;
+}
+
+int main(void)
+{
+	if (!mkdtemp(dir)) {
+		perror("mkdtemp");
+		return EXIT_FAILURE;
+	}
+
+	const char *err = v_test_run();
+
+	char *names[] = {"file", "linked", "link", "mapped", "symlink"};
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+		unlink(v_test_path(names[i]));
+	rmdir(dir);
+
+	if (err) {
+		printf("save: %s went wrong\n", err);
+		return EXIT_FAILURE;
+	}
+
+	printf("save: ok\n");
+
+	return EXIT_SUCCESS;
+}
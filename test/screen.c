@@ -0,0 +1,344 @@
+/*
+ * screen.c - Raw escape sequence screen check
+ *
+ * Checks that the frames sent by the raw escape sequence screen leave the
+ * terminal showing what was drawn. Random text, with both attributes, long
+ * runs of blanks and cleared line ends, is drawn on the screen and lines of
+ * it are scrolled, then a frame is sent. Its escape sequences are played on
+ * a model of the terminal, which must then hold every cell of the back
+ * buffer and the cursor where it was left. The screen is cleared and resized
+ * now and then. A frame drawing nothing new must send nothing, and one only
+ * moving the cursor must not start a synchronized update.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <ncurses.h>
+
+#include <void.h>
+
+#define V_TEST_FRAMES	5000		/* Random frames sent */
+#define V_TEST_ROWS	40		/* Most lines of the screen */
+#define V_TEST_COLS	120		/* Most columns of the screen */
+#define V_TEST_SIZE	(V_TEST_ROWS * V_TEST_COLS * 16)	/* Frame room */
+
+/* The terminal model, sized along with the screen */
+static struct v_cell term[V_TEST_ROWS * V_TEST_COLS];
+static int rows;
+static int cols;
+static int ty;
+static int tx;
+static int tattr;
+static int top;
+static int bot;
+static bool wrap;
+static bool update;
+static bool updated;
+
+static void v_test_blank(int y, int x, int n)
+{
+	for (int i = 0; i < n && x + i < cols; i++) {
+		term[y * cols + x + i].ch = ' ';
+		term[y * cols + x + i].attr = tattr;
+	}
+}
+
+static void v_test_scroll(int n)
+{
+	int lines = bot - top + 1;
+	int k = abs(n);
+	struct v_cell *p = &term[top * cols];
+
+	if (n > 0)
+		memmove(p, p + k * cols, sizeof(*p) * (lines - k) * cols);
+	else
+		memmove(p + k * cols, p, sizeof(*p) * (lines - k) * cols);
+	for (int i = 0; i < k; i++)
+		v_test_blank(n > 0 ? bot - i : top + i, 0, cols);
+}
+
+/* Plays a control sequence with its parameters, false if unknown */
+static bool v_test_csi(char final, bool priv, int *p, int np)
+{
+	int n = np && p[0] ? p[0] : 1;
+
+	if (priv && np == 1 && p[0] == 2026 && (final == 'h' || final == 'l')) {
+		if (update == (final == 'h'))
+			return false;
+		update = final == 'h';
+		updated |= update;
+		return true;
+	}
+
+	/* Cells only change within a synchronized update */
+	if (priv || (!update && strchr("JKXST", final)))
+		return false;
+
+	switch (final) {
+	case 'H':
+		ty = n - 1;
+		tx = np > 1 && p[1] ? p[1] - 1 : 0;
+		return ty < rows && tx < cols;
+	case 'A':
+		ty -= n;
+		return ty >= 0;
+	case 'B':
+		ty += n;
+		return ty < rows;
+	case 'C':
+		tx += n;
+		return tx < cols;
+	case 'D':
+		tx -= n;
+		return tx >= 0;
+	case 'J':
+		for (int y = 0; np && p[0] == 2 && y < rows; y++)
+			v_test_blank(y, 0, cols);
+		return np && p[0] == 2;
+	case 'K':
+		v_test_blank(ty, tx, cols - tx);
+		return !np;
+	case 'X':
+		v_test_blank(ty, tx, n);
+		return true;
+	case 'm':
+		if (!np || (np == 1 && !p[0]))
+			tattr = V_SCR_NORMAL;
+		else if (np == 3 && !p[0] && p[1] == 30 + V_BAR_FG &&
+			 p[2] == 40 + V_BAR_BG)
+			tattr = V_SCR_BAR;
+		else
+			return false;
+		return true;
+	case 'r':
+		top = np ? p[0] - 1 : 0;
+		bot = np > 1 ? p[1] - 1 : rows - 1;
+		ty = 0;
+		tx = 0;
+		return top >= 0 && top < bot && bot < rows;
+	case 'S':
+	case 'T':
+		v_test_scroll(final == 'S' ? n : -n);
+		return true;
+	}
+
+	return false;
+}
+
+/* Plays what the screen sent on the terminal model */
+static bool v_test_play(const char *s, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = s[i];
+		bool wrapped = wrap;
+
+		/* Past the last column, the cursor waits on it to wrap */
+		wrap = false;
+		if (c == '\r') {
+			tx = 0;
+		} else if (c == '\n') {
+			if (++ty >= rows)
+				return false;
+		} else if (c == '\033') {
+			int p[4] = {0};
+			int np = 0;
+			bool priv = false;
+
+			if (++i >= len || s[i] != '[')
+				return false;
+			if (i + 1 < len && s[i + 1] == '?') {
+				priv = true;
+				i++;
+			}
+			while (++i < len && (s[i] == ';' ||
+					     (s[i] >= '0' && s[i] <= '9'))) {
+				if (!np)
+					np = 1;
+				if (s[i] == ';' && np < 4)
+					np++;
+				else if (s[i] != ';')
+					p[np - 1] = p[np - 1] * 10 + s[i] - '0';
+			}
+			if (i >= len || !v_test_csi(s[i], priv, p, np))
+				return false;
+
+			/* Only moving the cursor takes it off the wait */
+			wrap = wrapped && (priv || s[i] == 'm');
+		} else if (c >= ' ' && c < 127) {
+			/* It is never let to wrap, nor to scroll the screen */
+			if (wrapped || !update ||
+			    (ty == rows - 1 && tx == cols - 1))
+				return false;
+			term[ty * cols + tx].ch = c;
+			term[ty * cols + tx].attr = tattr;
+			wrap = tx == cols - 1;
+			tx += !wrap;
+		} else {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Sends a frame and plays it, returning how many bytes it took */
+static long v_test_flush(struct v_screen *scr, FILE *out, int y, int x)
+{
+	static char buf[V_TEST_SIZE];
+	long from = ftell(out);
+
+	if (v_scr_flush(scr, y, x) == V_ERR || fseek(out, 0, SEEK_END))
+		return -1;
+
+	long len = ftell(out) - from;
+	if (len > (long)sizeof(buf) ||
+	    pread(fileno(out), buf, len, from) != len)
+		return -1;
+
+	updated = false;
+	if (!v_test_play(buf, len) || update)
+		return -1;
+
+	return len;
+}
+
+/* Whether the terminal shows the back buffer, but for the last cell */
+static bool v_test_shows(struct v_screen *scr, int y, int x)
+{
+	for (int i = 0; i < rows * cols - 1; i++)
+		if (term[i].ch != scr->back[i].ch ||
+		    term[i].attr != scr->back[i].attr)
+			return false;
+
+	return y == -1 || (ty == y && tx == x);
+}
+
+static int v_test_resize(struct v_screen *scr, int r, int c)
+{
+	rows = r;
+	cols = c;
+	wrap = false;
+	top = 0;
+	bot = rows - 1;
+
+	return v_scr_resize(scr, r, c);
+}
+
+static void v_test_draw(struct v_screen *scr)
+{
+	static char text[] = "abc  xyz\t\001          ~~~";
+	char s[64];
+
+	int n = rand() % 60;
+	for (int i = 0; i < n; i++)
+		s[i] = text[rand() % (sizeof(text) - 1)];
+
+	switch (rand() % 8) {
+	case 0:
+		v_scr_move(scr, rand() % rows, rand() % cols);
+		v_scr_clrtoeol(scr);
+		break;
+	case 1:
+		/* A status bar, with the blanks it is padded with */
+		v_scr_move(scr, rand() % rows, 0);
+		v_scr_attr(scr, V_SCR_BAR);
+		v_scr_put(scr, s, n);
+		memset(s, ' ', sizeof(s));
+		v_scr_put(scr, s, sizeof(s));
+		v_scr_put(scr, s, sizeof(s));
+		v_scr_attr(scr, V_SCR_NORMAL);
+		break;
+	case 2:
+		if (rows > 2) {
+			int t = rand() % (rows - 1);
+			int b = t + 1 + rand() % (rows - t - 1);
+			int k = 1 + rand() % (b - t);
+			v_scr_scroll(scr, t, b, rand() % 2 ? k : -k);
+		}
+		break;
+	default:
+		v_scr_move(scr, rand() % rows, rand() % cols);
+		v_scr_attr(scr, rand() % 4 ? V_SCR_NORMAL : V_SCR_BAR);
+		v_scr_put(scr, s, n);
+		v_scr_attr(scr, V_SCR_NORMAL);
+	}
+}
+
+static const char *v_test_run(struct v_screen *scr, FILE *out)
+{
+	if (v_test_resize(scr, 24, 80) == V_ERR)
+		return "sizing the screen";
+
+	for (int i = 0; i < V_TEST_FRAMES; i++) {
+		if (i % 500 == 499 &&
+		    v_test_resize(scr, 1 + rand() % V_TEST_ROWS,
+				  1 + rand() % V_TEST_COLS) == V_ERR)
+			return "resizing the screen";
+		if (i % 100 == 49)
+			v_scr_invalidate(scr);
+
+		int n = rand() % 8;
+		for (int k = 0; k < n; k++)
+			v_test_draw(scr);
+
+		int y = rand() % 10 ? rand() % rows : -1;
+		int x = y == -1 ? -1 : rand() % cols;
+		if (v_test_flush(scr, out, y, x) == -1)
+			return "sending a frame";
+		if (!v_test_shows(scr, y, x))
+			return "the cells shown";
+
+		/* Nothing new to show */
+		if (v_test_flush(scr, out, y, x) != 0)
+			return "sending an unchanged frame";
+
+		/* Only the cursor to move, off the line it was left on */
+		int to = (ty + 1) % rows;
+		if (rows > 1 &&
+		    (v_test_flush(scr, out, to, 0) <= 0 || updated))
+			return "moving the cursor";
+		if (rows > 1 && !v_test_shows(scr, to, 0))
+			return "the cursor moved";
+	}
+
+	return NULL;
+}
+
+int main(void)
+{
+	FILE *out = tmpfile();
+	if (!out) {
+		perror("tmpfile");
+		return EXIT_FAILURE;
+	}
+
+	struct v_screen *scr = v_scr_new(fileno(out));
+	if (!scr) {
+		perror("v_scr_new");
+		return EXIT_FAILURE;
+	}
+
+	srand(25);
+	const char *err = v_test_run(scr, out);
+
+	v_scr_free(scr);
+	fclose(out);
+
+	if (err) {
+		printf("screen: %s went wrong\n", err);
+		return EXIT_FAILURE;
+	}
+
+	printf("screen: ok\n");
+
+	return EXIT_SUCCESS;
+}
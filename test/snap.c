@@ -0,0 +1,175 @@
+/*
+ * snap.c - Background save check
+ *
+ * Checks that a file saved in the background holds the buffer content as it
+ * was when the saving started, however the buffer gets edited meanwhile. A
+ * file is loaded in every loading mode and edited, so that some rows borrow
+ * the loaded text, some the pasted one and some own their own copy. It is
+ * then saved while the very same rows keep being edited and deleted. Once
+ * the saving is done, the file must hold the content the buffer had when it
+ * started, and a second save must pick up every edit made since.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <void.h>
+
+#define V_TEST_LINES	50000		/* Lines of the loaded file */
+#define V_TEST_SIZE	(V_TEST_LINES * 32)	/* Room for the content */
+
+static char path[] = "/tmp/void-snap-XXXXXX";
+
+/* Copies the buffer content out as it would be saved */
+static size_t v_test_text(struct v_state *v, char *buf)
+{
+	size_t len = 0;
+
+	for (int y = 0; y < v->nrows; y++) {
+		struct v_row *row = v_row_at(v, y);
+		char *s = NULL;
+		int n = 0;
+
+		for (int i = 0; (n = v_row_seg(row, i, &s)) != V_ERR; i++) {
+			memcpy(buf + len, s, n);
+			len += n;
+		}
+		buf[len++] = '\n';
+	}
+
+	return len;
+}
+
+static bool v_test_holds(char *text, size_t len)
+{
+	static char buf[V_TEST_SIZE];
+	FILE *fp = fopen(path, "r");
+	if (!fp)
+		return false;
+
+	size_t n = fread(buf, 1, sizeof(buf), fp);
+	fclose(fp);
+
+	return n == len && !memcmp(buf, text, len);
+}
+
+/* Edits rows near the top, some of the text borrowed, some owned */
+static int v_test_edit(struct v_state *v, int round)
+{
+	char s[] = "pasted\nlines\n";
+
+	for (int i = 0; i < 100; i++) {
+		v->cur_y = (i * 7 + round) % 50;
+		v->cur_x = v_row_at(v, v->cur_y)->len < 2 ? 0 : 2;
+		if (v_insert(v, 'a' + i % 26) == V_ERR)
+			return V_ERR;
+		if (i % 3 == 0 && v_paste(v, s, strlen(s)) == V_ERR)
+			return V_ERR;
+		if (i % 5 == 0 && v_bksp(v) == V_ERR)
+			return V_ERR;
+		if (i % 7 == 0 && v_del_row(v, v->cur_y) == V_ERR)
+			return V_ERR;
+	}
+
+	return V_OK;
+}
+
+static const char *v_test_mode(int mode)
+{
+	static char want[V_TEST_SIZE];
+	static char now[V_TEST_SIZE];
+	const char *err = NULL;
+
+	struct v_state *v = v_new_state();
+	if (!v)
+		return "state";
+
+	v->pt = mode == 1;
+	v->mm = mode == 2;
+	v->sync = V_SYNC_NONE;
+	if (v_open(v, path) == V_ERR || v_test_edit(v, 0) == V_ERR) {
+		err = "editing";
+		goto out;
+	}
+
+	size_t len = v_test_text(v, want);
+	if (v_save_start(v) == V_ERR) {
+		err = "starting to save";
+		goto out;
+	}
+
+	/* The saver thread is still writing the snapshot out */
+	if (v_test_edit(v, 1) == V_ERR) {
+		err = "editing while saving";
+		goto out;
+	}
+	size_t nlen = v_test_text(v, now);
+
+	if (v_save_poll(v, true) == V_ERR || !v_test_holds(want, len)) {
+		err = "saving a snapshot";
+		goto out;
+	}
+	if (!v->dirty) {
+		err = "the dirty flag";
+		goto out;
+	}
+
+	if (v_save_start(v) == V_ERR || v_save_poll(v, true) == V_ERR ||
+	    !v_test_holds(now, nlen))
+		err = "saving again";
+
+out:
+	/* Saving started a journal, with edits to keep in a swap file */
+	v_save_poll(v, true);
+	v_jrnl_close(v);
+	v_free_rows(v);
+	free(v->filename);
+	free(v);
+
+	return err;
+}
+
+int main(void)
+{
+	static const char *modes[] = {"read", "piece table", "mapped"};
+	const char *err = NULL;
+	int mode = 0;
+
+	int fd = mkstemp(path);
+	FILE *fp = fd == -1 ? NULL : fdopen(fd, "w");
+	if (!fp) {
+		perror("mkstemp");
+		return EXIT_FAILURE;
+	}
+
+	for (int i = 0; i < V_TEST_LINES; i++)
+		fprintf(fp, "line %d\n", i);
+	if (fclose(fp) != 0) {
+		perror("write");
+		unlink(path);
+		return EXIT_FAILURE;
+	}
+
+	for (mode = 0; mode < 3 && !err; mode++)
+		err = v_test_mode(mode);
+
+	unlink(path);
+	if (err) {
+		printf("snap: %s went wrong in %s mode\n", err,
+		       modes[mode - 1]);
+		return EXIT_FAILURE;
+	}
+
+	printf("snap: ok\n");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,197 @@
+/*
+ * tree.c - Row tree check
+ *
+ * Checks that the row tree keeps its rows in order while rows are inserted
+ * and deleted at random, one at a time and in whole batches, so that leaves
+ * and nodes get split, merged and the tree grows and shrinks by a level. The
+ * rows are told apart by the text they borrow. After each round of edits, the
+ * rows are compared to an array edited the same way, and every count, leaf
+ * size and leaf link of the tree is checked.
+ *
+ * Current development and maintenance by:
+ * 	Copyright (c) 2025-Present Luth <https://github.com/mkluth>
+ *
+ * This file is a part of the void text editor.
+ * It is licensed under MIT License. See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <void.h>
+
+#define V_TEST_ROUNDS	200		/* Rounds of random edits */
+#define V_TEST_EDITS	400		/* Single row edits per round */
+#define V_TEST_ROWS	200000		/* Most rows the tree may get */
+#define V_TEST_BATCH	2000		/* Most rows inserted per batch */
+#define V_TEST_TAGS	1048576		/* Rows ever inserted */
+
+static char text[V_TEST_TAGS];
+static int ntext;
+static char *ref[V_TEST_ROWS];
+static int nref;
+
+static struct v_leaf *seen;
+
+/* Returns the number of rows under kid, -1 if it breaks the tree rules */
+static int v_test_walk(void *kid, int level, int height)
+{
+	if (level == height) {
+		struct v_leaf *leaf = kid;
+		if (leaf->n < 1 || leaf->n > V_LEAF_MAX || leaf->prev != seen ||
+		    (seen && seen->next != leaf))
+			return -1;
+		seen = leaf;
+		return leaf->n;
+	}
+
+	struct v_node *node = kid;
+	int sum = 0;
+	if (node->n < 1 || node->n > V_NODE_MAX)
+		return -1;
+
+	for (int i = 0; i < node->n; i++) {
+		int n = v_test_walk(node->kid[i], level + 1, height);
+		if (n == -1 || n != node->cnt[i])
+			return -1;
+		sum += n;
+	}
+
+	return sum;
+}
+
+static const char *v_test_check(struct v_state *v)
+{
+	if (v->nrows != nref)
+		return "row count";
+	if (v->height > V_TREE_DEPTH)
+		return "height";
+
+	seen = NULL;
+	if (v->root && v_test_walk(v->root, 0, v->height) != nref)
+		return "tree";
+	if (seen && seen->next)
+		return "last leaf";
+
+	for (int y = 0; y < nref; y++)
+		if (v_row_at(v, y)->orig != ref[y])
+			return "row order";
+
+	/* Backwards, past the cached leaf every time */
+	for (int y = nref - 1; y >= 0; y -= 7)
+		if (v_row_at(v, y)->orig != ref[y])
+			return "row order backwards";
+
+	return NULL;
+}
+
+static int v_test_insert(struct v_state *v, int y, int n)
+{
+	static struct v_line lines[V_TEST_BATCH];
+
+	if (nref + n > V_TEST_ROWS)
+		n = V_TEST_ROWS - nref;
+	if (ntext + n > V_TEST_TAGS)
+		ntext = 0;
+
+	memmove(&ref[y + n], &ref[y], sizeof(char *) * (nref - y));
+	for (int i = 0; i < n; i++) {
+		lines[i].s = &text[ntext++];
+		lines[i].len = 1;
+		ref[y + i] = lines[i].s;
+	}
+	nref += n;
+
+	/* Single rows go through v_tree_insert(), batches do not */
+	if (n == 1)
+		return v_insert_row_ref(v, y, lines[0].s, 1);
+
+	return v_insert_rows_ref(v, y, lines, n);
+}
+
+static int v_test_delete(struct v_state *v, int y)
+{
+	memmove(&ref[y], &ref[y + 1], sizeof(char *) * (nref - y - 1));
+	nref--;
+
+	return v_del_row(v, y);
+}
+
+/* Grows the tree for the first half of the rounds, shrinks it afterwards */
+static int v_test_round(struct v_state *v, int round)
+{
+	bool grow = round < V_TEST_ROUNDS / 2;
+	int hot = nref ? rand() % nref : 0;
+
+	if (grow) {
+		int n = 2 + rand() % (V_TEST_BATCH - 1);
+		if (v_test_insert(v, rand() % (nref + 1), n) == V_ERR)
+			return V_ERR;
+	}
+
+	for (int i = 0; i < V_TEST_EDITS; i++) {
+		int y = rand() % (nref + 1);
+
+		/* Keep hitting the same leaf to split it over and over */
+		if (i % 2)
+			y = hot < nref ? hot : nref;
+
+		if (rand() % 10 < (grow ? 6 : 2)) {
+			if (v_test_insert(v, y, 1) == V_ERR)
+				return V_ERR;
+		} else if (nref) {
+			y = y < nref ? y : nref - 1;
+			if (v_test_delete(v, y) == V_ERR)
+				return V_ERR;
+		}
+	}
+
+	/* Empty the tree at the end to take it down to nothing */
+	while (round == V_TEST_ROUNDS - 1 && nref)
+		if (v_test_delete(v, rand() % nref) == V_ERR)
+			return V_ERR;
+
+	return V_OK;
+}
+
+int main(void)
+{
+	struct v_state *v = v_new_state();
+	if (!v) {
+		perror("state");
+		return EXIT_FAILURE;
+	}
+
+	memset(text, 'r', sizeof(text));
+
+	srand(3);
+	const char *err = NULL;
+	int height = 0;
+	for (int i = 0; i < V_TEST_ROUNDS && !err; i++) {
+		if (v_test_round(v, i) == V_ERR)
+			err = "edit";
+		else
+			err = v_test_check(v);
+		if (err)
+			printf("tree: %s is wrong after round %d\n", err, i);
+		if (v->height > height)
+			height = v->height;
+	}
+
+	/* Nothing was tried if the tree never got a node split */
+	if (!err && height < 2) {
+		printf("tree: only grew %d levels high\n", height);
+		err = "height";
+	}
+
+	v_free_rows(v);
+	free(v);
+	if (err)
+		return EXIT_FAILURE;
+
+	printf("tree: ok\n");
+
+	return EXIT_SUCCESS;
+}